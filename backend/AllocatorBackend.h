@@ -0,0 +1,47 @@
+#pragma once
+// 统一的分配器后端接口：基准测试通过它在同一程序中并排对比各版本内存池与系统分配器。
+// v1/v2 以改名后的命名空间编译进各自的库（见 cmake/KamaPoolLibraries.cmake），只能经由此接口使用
+#include <cstddef>
+#include <cstdlib>
+#include <malloc.h>
+
+namespace kama_backend
+{
+
+struct AllocatorBackend
+{
+    const char* name;
+    void   (*init)();                            // 使用前的初始化，不需要时为nullptr
+    void*  (*allocate)(size_t size);
+    void   (*deallocate)(void* ptr, size_t size);
+    size_t (*mappedBytes)();                     // 分配器从系统持有的字节数，不可得时为nullptr
+};
+
+// 分别由 kama_pool_v1、kama_pool_v2、kama_pool_v3 提供
+const AllocatorBackend& v1Backend();
+const AllocatorBackend& v2Backend();
+const AllocatorBackend& v3Backend();
+// v3的分片小对象堆（ShardedHeap），同样由 kama_pool_v3 提供
+const AllocatorBackend& v3ShardedBackend();
+
+// 系统分配器，不需要链接任何库
+inline const AllocatorBackend& systemBackend()
+{
+    static const AllocatorBackend backend = {
+        "system",
+        nullptr,
+        [](size_t size) { return malloc(size); },
+        [](void* ptr, size_t) { free(ptr); },
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+        []() -> size_t {
+            struct mallinfo2 info = mallinfo2();
+            return info.arena + info.hblkhd;
+        },
+#else
+        nullptr,
+#endif
+    };
+    return backend;
+}
+
+} // namespace kama_backend
@@ -0,0 +1,20 @@
+// 编译进 kama_pool_v1，MemoryPool.h 取自 v1/include
+#include "MemoryPool.h"
+#include "AllocatorBackend.h"
+
+namespace kama_backend
+{
+
+const AllocatorBackend& v1Backend()
+{
+    static const AllocatorBackend backend = {
+        "v1",
+        []() { Kama_memoryPool::HashBucket::initMemoryPool(); },
+        [](size_t size) { return Kama_memoryPool::HashBucket::useMemory(size); },
+        [](void* ptr, size_t size) { Kama_memoryPool::HashBucket::freeMemory(ptr, size); },
+        nullptr,
+    };
+    return backend;
+}
+
+} // namespace kama_backend
@@ -0,0 +1,20 @@
+// 编译进 kama_pool_v2，MemoryPool.h 取自 v2/include
+#include "MemoryPool.h"
+#include "AllocatorBackend.h"
+
+namespace kama_backend
+{
+
+const AllocatorBackend& v2Backend()
+{
+    static const AllocatorBackend backend = {
+        "v2",
+        nullptr,
+        [](size_t size) { return Kama_memoryPool::MemoryPool::allocate(size); },
+        [](void* ptr, size_t size) { Kama_memoryPool::MemoryPool::deallocate(ptr, size); },
+        nullptr,
+    };
+    return backend;
+}
+
+} // namespace kama_backend
@@ -0,0 +1,36 @@
+// 编译进 kama_pool_v3，MemoryPool.h 取自 v3/include
+#include "MemoryPool.h"
+#include "ShardedHeap.h"
+#include "AllocatorBackend.h"
+
+namespace kama_backend
+{
+
+const AllocatorBackend& v3Backend()
+{
+    static const AllocatorBackend backend = {
+        "v3",
+        nullptr,
+        [](size_t size) { return Kama_memoryPool::MemoryPool::allocate(size); },
+        [](void* ptr, size_t size) { Kama_memoryPool::MemoryPool::deallocate(ptr, size); },
+        []() -> size_t {
+            Kama_memoryPool::PoolStats stats = Kama_memoryPool::MemoryPool::getStats();
+            return stats.mappedBytes - stats.releasedBytes;
+        },
+    };
+    return backend;
+}
+
+const AllocatorBackend& v3ShardedBackend()
+{
+    static const AllocatorBackend backend = {
+        "v3_shard",
+        nullptr,
+        [](size_t size) { return Kama_memoryPool::ShardedHeap::allocate(size); },
+        [](void* ptr, size_t size) { Kama_memoryPool::ShardedHeap::deallocate(ptr, size); },
+        v3Backend().mappedBytes,
+    };
+    return backend;
+}
+
+} // namespace kama_backend
@@ -0,0 +1,40 @@
+# 优化构建模式：ENABLE_LTO 开启 -O3 与链接时优化；PGO=GENERATE/USE 为两阶段的配置文件引导优化。
+# 须在定义任何目标之前引入，选项作用于之后定义的全部目标。完整的PGO流程见 v3/CMakeLists.txt 中的 pgo 目标
+include_guard(GLOBAL)
+
+option(ENABLE_LTO "Build with -O3 and link-time optimization" OFF)
+set(PGO OFF CACHE STRING "Profile-guided optimization stage: OFF, GENERATE (instrumented) or USE (optimized)")
+set_property(CACHE PGO PROPERTY STRINGS OFF GENERATE USE)
+set(PGO_DIR ${CMAKE_BINARY_DIR}/pgo-profile CACHE PATH "Directory holding the PGO profile data")
+
+if(ENABLE_LTO)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT lto_supported OUTPUT lto_output LANGUAGES CXX)
+    if(NOT lto_supported)
+        message(FATAL_ERROR "ENABLE_LTO: link-time optimization is not supported: ${lto_output}")
+    endif()
+    # 排在 -O2 之后，后出现的优化级别生效
+    add_compile_options(-O3)
+    set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON)
+endif()
+
+if(PGO STREQUAL "GENERATE" OR PGO STREQUAL "USE")
+    if(NOT CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        message(FATAL_ERROR "PGO=${PGO} is only wired up for GCC")
+    endif()
+    # 去掉构建目录前缀，插桩构建与优化构建在不同目录时数据文件名仍然一致
+    set(pgo_flags -fprofile-prefix-path=${CMAKE_BINARY_DIR})
+    if(PGO STREQUAL "GENERATE")
+        # 多线程训练时计数器须原子更新，否则数据不一致
+        list(APPEND pgo_flags -fprofile-generate=${PGO_DIR} -fprofile-update=atomic)
+    else()
+        # 训练未覆盖的文件按普通方式优化，不报警告
+        list(APPEND pgo_flags -fprofile-use=${PGO_DIR} -fprofile-correction -Wno-missing-profile)
+    endif()
+    add_compile_options(${pgo_flags})
+    string(REPLACE ";" " " pgo_link_flags "${pgo_flags}")
+    string(APPEND CMAKE_EXE_LINKER_FLAGS " ${pgo_link_flags}")
+    string(APPEND CMAKE_SHARED_LINKER_FLAGS " ${pgo_link_flags}")
+elseif(NOT PGO STREQUAL "OFF")
+    message(FATAL_ERROR "PGO must be OFF, GENERATE or USE, got '${PGO}'")
+endif()
@@ -0,0 +1,49 @@
+# 内存池库：kama_pool_vN（静态库）与 kama_pool_vN_shared（动态库，文件名同为 libkama_pool_vN.so），
+# 同时编入 backend/ 下的统一后端接口。顶层构建与 v3 单独构建共用本文件
+include_guard(GLOBAL)
+
+set(KAMA_POOL_ROOT ${CMAKE_CURRENT_LIST_DIR}/..)
+find_package(Threads REQUIRED)
+
+# 慢路径延迟直方图插桩，默认关闭
+option(ENABLE_LATENCY_HISTOGRAM "Record rdtsc latency histograms on allocator slow paths" OFF)
+# USDT静态探针（见v3/include/Probes.h），未挂载时只是一条nop
+option(ENABLE_PROBES "Emit USDT probes on tier transitions" ON)
+
+# kama_add_pool_library(v1|v2|v3)
+# v1/v2 的源码用宏把命名空间 Kama_memoryPool 改名为 Kama_memoryPool_vN，
+# 因而可以与 v3 链接进同一个程序，对外只通过 AllocatorBackend 使用。
+# 静态库与动态库分别编译：静态库不加 -fPIC，避免 thread_local 访问退化为 __tls_get_addr 调用
+function(kama_add_pool_library version)
+    set(name kama_pool_${version})
+    if(TARGET ${name})
+        return()
+    endif()
+
+    set(dir ${KAMA_POOL_ROOT}/${version})
+    string(TOUPPER ${version} upper)
+    file(GLOB sources ${dir}/src/*.cpp)
+    list(APPEND sources ${KAMA_POOL_ROOT}/backend/${upper}Backend.cpp)
+
+    add_library(${name} STATIC ${sources})
+    add_library(${name}_shared SHARED ${sources})
+    set_target_properties(${name}_shared PROPERTIES OUTPUT_NAME ${name})
+
+    foreach(lib ${name} ${name}_shared)
+        # 各版本的源码以 "X.h" 包含自己的头文件，须排在其他头文件目录之前
+        target_include_directories(${lib} BEFORE PRIVATE ${dir}/include)
+        target_include_directories(${lib} PUBLIC ${KAMA_POOL_ROOT}/backend)
+        target_link_libraries(${lib} PUBLIC Threads::Threads ${CMAKE_DL_LIBS})
+        if(version STREQUAL "v3")
+            target_include_directories(${lib} PUBLIC ${dir}/include)
+            if(ENABLE_LATENCY_HISTOGRAM)
+                target_compile_definitions(${lib} PUBLIC KAMA_LATENCY_HISTOGRAM)
+            endif()
+            if(NOT ENABLE_PROBES)
+                target_compile_definitions(${lib} PUBLIC KAMA_DISABLE_PROBES)
+            endif()
+        else()
+            target_compile_definitions(${lib} PRIVATE Kama_memoryPool=Kama_memoryPool_${version})
+        endif()
+    endforeach()
+endfunction()
@@ -0,0 +1,92 @@
+#pragma once
+#include "Common.h"
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Kama_memoryPool
+{
+
+// 区域分配器：从PageCache获取整块span，在其中按指针递增分配，
+// 不支持单个对象释放，通过rewind/reset一次性回收。
+// 适合“请求内分配大量小对象、请求结束统一释放”的场景。非线程安全
+class Arena
+{
+    struct Chunk
+    {
+        Chunk* prev;     // 上一个span（当前链表按分配顺序倒序串联）
+        size_t numPages; // span页数
+    };
+
+public:
+    static const size_t DEFAULT_CHUNK_PAGES = 16; // 默认每次申请64KB
+
+    // 检查点：记录当前分配位置，rewind回到该位置
+    struct Checkpoint
+    {
+        Chunk* chunk;
+        char*  cursor;
+    };
+
+    // chunkPages为每次向PageCache申请的页数；
+    // keepChunks为reset后保留复用的最大span个数，避免下次重新向PageCache申请
+    explicit Arena(size_t chunkPages = DEFAULT_CHUNK_PAGES, size_t keepChunks = 0);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // alignment须为2的幂且不超过页大小
+    void* allocate(size_t size, size_t alignment = ALIGNMENT)
+    {
+        uintptr_t p = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) & ~(alignment - 1);
+        if (cursor_ && p + size <= reinterpret_cast<uintptr_t>(end_))
+        {
+            cursor_ = reinterpret_cast<char*>(p + size);
+            return reinterpret_cast<void*>(p);
+        }
+        return allocateSlow(size, alignment);
+    }
+
+    // 在arena中构造对象，reset/rewind时不会调用析构函数
+    template<typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena::create: destructors are never run");
+        void* mem = allocate(sizeof(T), alignof(T));
+        return mem ? new (mem) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    Checkpoint checkpoint() const { return {current_, cursor_}; }
+
+    // 回退到检查点，检查点之后分配的内存全部作废；检查点可以嵌套，须按后进先出顺序回退
+    void rewind(const Checkpoint& checkpoint);
+
+    // 释放全部内存，保留最大的keepChunks个span供后续复用
+    void reset();
+
+    // 已向PageCache申请（含保留复用）的字节数
+    size_t bytesReserved() const;
+
+private:
+    void* allocateSlow(size_t size, size_t alignment);
+    // 获取至少能容纳minBytes可用空间的span，优先复用保留的span
+    Chunk* obtainChunk(size_t minBytes);
+    void releaseChunk(Chunk* chunk);
+    // 只保留最大的keepChunks_个空闲span，其余归还PageCache
+    void trimSpare();
+
+    static char* chunkBegin(Chunk* chunk) { return reinterpret_cast<char*>(chunk + 1); }
+    static char* chunkEnd(Chunk* chunk);
+
+private:
+    Chunk* current_;    // 当前正在分配的span
+    char*  cursor_;     // 当前分配位置
+    char*  end_;        // 当前span的末尾
+    Chunk* spare_;      // 已回退、可复用的span
+    size_t chunkPages_;
+    size_t keepChunks_;
+};
+
+} // namespace memoryPool
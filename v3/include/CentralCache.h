@@ -1,5 +1,7 @@
 #pragma once
 #include "Common.h"
+#include "Numa.h"
+#include "PoolStats.h"
 #include <mutex>
 
 namespace Kama_memoryPool
@@ -8,18 +10,38 @@ namespace Kama_memoryPool
 class CentralCache
 {
 public:
+    // 当前线程所在节点的分区
     static CentralCache& getInstance()
     {
-        static CentralCache instance;
-        return instance;
+        return forNode(Numa::currentNode());
     }
 
-    void* fetchRange(size_t index, size_t batchNum);
-    void returnRange(void* start, size_t size, size_t bytes);
+    // 每个NUMA节点一个分区，从同一节点的页缓存分区取span，单节点时只有一个分区
+    static CentralCache& forNode(size_t node)
+    {
+        static CentralCache* partitions = createPartitions();
+        return partitions[node];
+    }
+
+    // 获取最多batchNum个内存块组成的链表，fetchedNum返回实际数量
+    void* fetchRange(size_t index, size_t batchNum, size_t& fetchedNum);
+    // 归还以start开头的count个内存块，其他节点的块还给各自所属分区
+    void returnRange(void* start, size_t count, size_t index);
+
+    // fork前取得所有分区各大小类的锁，fork后在父子进程中释放
+    static void lockForFork();
+    static void unlockAfterFork();
+
+    // 汇总各分区各大小类的中心缓存块数、获取/归还次数，并推算释放次数；
+    // 须在ThreadCache::collectStats之后调用
+    static void collectStats(PoolStats& stats);
 
 private:
+    static CentralCache* createPartitions();
+
     // 相互是还所有原子指针为nullptr
-    CentralCache()
+    explicit CentralCache(size_t node)
+        : node_(node)
     {
         for (auto& ptr : centralFreeList_)
         {
@@ -33,13 +55,40 @@ private:
     }
     // 从页缓存获取内存
     void* fetchFromPageCache(size_t size);
+    // 向页缓存申请新span作为该大小类的待切分区域，调用方须持有对应的锁
+    bool refillSpan(size_t index, size_t size);
+    // 把count个块的链表接到本分区的中心缓存
+    void pushRange(void* start, size_t count, size_t index);
 
 private:
+    size_t node_;
+
     // 中心缓存的自由链表
     std::array<std::atomic<void*>, FREE_LIST_SIZE> centralFreeList_;
 
     // 用于同步的自旋锁
     std::array<std::atomic_flag, FREE_LIST_SIZE> locks_;
+
+    // 各大小类的计数，受对应自旋锁保护；
+    // 分区位于静态存储区，初始全零，构造时不再逐项清零以免占用物理页
+    struct ClassCounters
+    {
+        size_t freeBlocks;     // 中心缓存中的空闲块数，含待切分区域
+        size_t fetches;        // fetchRange次数
+        size_t fetchedBlocks;  // 交给线程缓存的块数
+        size_t returns;        // returnRange次数
+        size_t returnedBlocks; // 线程缓存归还的块数
+    };
+    std::array<ClassCounters, FREE_LIST_SIZE> counters_;
+
+    // 新span的待切分区域[cursor, end)：块被取走时才写入链表指针，
+    // 不再在获取span时整段串链，未用到的页不会被访问；同样受对应自旋锁保护
+    struct SpanCursor
+    {
+        char* cursor;
+        char* end;
+    };
+    std::array<SpanCursor, FREE_LIST_SIZE> spanCursors_;
 };
 
 } // namespace memoryPool
\ No newline at end of file
@@ -2,6 +2,11 @@
 #include <cstddef>
 #include <atomic>
 #include <array>
+#include <algorithm>
+
+// 分支预测提示，用于热路径（C++17中还没有[[likely]]）
+#define KAMA_LIKELY(x)   __builtin_expect(!!(x), 1)
+#define KAMA_UNLIKELY(x) __builtin_expect(!!(x), 0)
 
 namespace Kama_memoryPool 
 {
@@ -22,12 +27,26 @@ struct BlockHeader
 class SizeClass 
 {
 public:
-    static size_t roundUp(size_t bytes)
+    static constexpr size_t roundUp(size_t bytes)
     {
         return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
     }
 
-    static size_t getIndex(size_t bytes)
+    // 向上取整到alignment（2的幂）的倍数
+    static constexpr size_t roundUp(size_t bytes, size_t alignment)
+    {
+        return (bytes + alignment - 1) & ~(alignment - 1);
+    }
+
+    // 对齐分配实际使用的大小：
+    // span起始地址页对齐，大小类内的块按块大小紧密排布，
+    // 所以块大小是alignment的倍数时块地址天然满足对齐要求
+    static constexpr size_t alignedSize(size_t bytes, size_t alignment)
+    {
+        return roundUp(std::max(bytes, alignment), alignment);
+    }
+
+    static constexpr size_t getIndex(size_t bytes)
     {   
         // 确保bytes至少为ALIGNMENT
         bytes = std::max(bytes, ALIGNMENT);
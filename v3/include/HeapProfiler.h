@@ -0,0 +1,100 @@
+#pragma once
+#include "Common.h"
+#include "PageCache.h"
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+namespace Kama_memoryPool
+{
+
+// 采样堆分析器：线程缓存每分配约sampleRate字节（指数分布间隔）采样一次，
+// 记录调用栈，输出当前仍未释放的采样对象。
+// 被采样的小对象单独占用页对齐的span，释放时只需检查页对齐的地址
+class HeapProfiler
+{
+public:
+    static const size_t DEFAULT_SAMPLE_RATE = 512 * 1024;
+    static const int    MAX_DEPTH = 32;
+
+    // 开始采样，平均每分配sampleRate字节采样一次
+    static void start(size_t sampleRate = DEFAULT_SAMPLE_RATE);
+    // 停止采样，已采样对象仍会在释放时移除
+    static void stop();
+
+    // 0表示未开启
+    static size_t getSampleRate()
+    {
+        return sampleRate_.load(std::memory_order_relaxed);
+    }
+
+    // 当前未释放的采样对象数
+    static size_t liveSamples()
+    {
+        return liveSamples_.load(std::memory_order_relaxed);
+    }
+
+    // 输出gperftools旧版文本格式（heap_v2），可直接交给pprof解析
+    static void writeHeapProfile(FILE* out);
+    // 输出折叠栈格式（每行“栈帧;栈帧;... 字节数”，字节数为按采样率还原的估计值），供火焰图使用
+    static void writeCollapsedStacks(FILE* out);
+
+    // fork前取得采样表的锁，fork后在父子进程中释放
+    static void lockForFork() { mutex_.lock(); }
+    static void unlockAfterFork() { mutex_.unlock(); }
+
+    // 以下供ThreadCache调用
+
+    // 记录采样对象，调用栈从调用者的调用者开始记录
+    static bool recordSample(void* ptr, size_t size, size_t sampleRate);
+
+    // ptr是采样对象时从表中移除并返回true
+    static bool removeIfSampled(void* ptr)
+    {
+        return mayBeSampled(ptr) && removeSample(ptr);
+    }
+
+    static bool isSampled(void* ptr)
+    {
+        return mayBeSampled(ptr) && findSample(ptr);
+    }
+
+private:
+    struct Sample
+    {
+        void*   ptr;
+        size_t  size;       // 请求大小
+        size_t  sampleRate; // 采样时的采样率，用于还原估计值
+        int     depth;
+        void*   stack[MAX_DEPTH];
+        Sample* next;
+    };
+
+    static const size_t TABLE_SIZE = 4096;
+
+    // 采样对象一定页对齐，其余地址无需查表；页对齐的地址再由removeSample/findSample
+    // 在加锁前检查span的采样标记，绝大多数未采样的块不会碰到互斥锁
+    static bool mayBeSampled(void* ptr)
+    {
+        return (reinterpret_cast<uintptr_t>(ptr) & (PageCache::PAGE_SIZE - 1)) == 0
+            && liveSamples_.load(std::memory_order_relaxed) != 0;
+    }
+
+    static size_t bucketOf(void* ptr)
+    {
+        return (reinterpret_cast<uintptr_t>(ptr) / PageCache::PAGE_SIZE) % TABLE_SIZE;
+    }
+
+    static bool removeSample(void* ptr);
+    static bool findSample(void* ptr);
+    // 复制当前所有采样记录，count返回数量，结果需调用方释放
+    static Sample* snapshot(size_t& count);
+
+private:
+    static std::atomic<size_t> sampleRate_;
+    static std::atomic<size_t> liveSamples_;
+    static std::mutex mutex_;
+    static Sample* table_[TABLE_SIZE]; // 按地址散列的链表
+};
+
+} // namespace memoryPool
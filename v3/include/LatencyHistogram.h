@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Kama_memoryPool
+{
+
+// 被统计延迟的慢路径，按所在层划分
+enum class LatencyOp
+{
+    THREAD_FETCH,         // ThreadCache::fetchFromCentralCache
+    THREAD_RETURN,        // ThreadCache::returnToCentralCache
+    CENTRAL_FETCH_RANGE,  // CentralCache::fetchRange
+    CENTRAL_RETURN_RANGE, // CentralCache::returnRange
+    CENTRAL_FETCH_PAGE,   // CentralCache::fetchFromPageCache
+    PAGE_ALLOCATE_SPAN,   // PageCache::allocateSpan
+    PAGE_DEALLOCATE_SPAN, // PageCache::deallocateSpan
+    PAGE_SYSTEM_ALLOC,    // PageCache::systemAlloc
+    COUNT
+};
+
+// 单个操作的延迟分布快照，单位纳秒
+struct LatencySnapshot
+{
+    uint64_t count;
+    double   p50;
+    double   p99;
+    double   p999;
+    double   max;
+};
+
+// 慢路径延迟直方图：以时间戳计数器的周期数为单位，
+// 按HDR风格的对数分桶记录（每个2的幂区间再均分8个子桶，相对误差不超过12.5%）。
+// 只在定义KAMA_LATENCY_HISTOGRAM（CMake选项ENABLE_LATENCY_HISTOGRAM）时插桩
+class LatencyHistogram
+{
+public:
+    static const size_t SUB_BUCKET_BITS = 3;
+    static const size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static void record(LatencyOp op, uint64_t cycles)
+    {
+        size_t i = static_cast<size_t>(op);
+        buckets_[i][bucketOf(cycles)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = max_[i].load(std::memory_order_relaxed);
+        while (cycles > max && !max_[i].compare_exchange_weak(max, cycles, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // now()返回值每纳秒的增量
+    static double cyclesPerNs();
+
+    static LatencySnapshot snapshot(LatencyOp op);
+    static void reset();
+    // 输出各操作的 p50/p99/p999/max
+    static void report(FILE* out);
+    static const char* name(LatencyOp op);
+
+    static size_t bucketOf(uint64_t value)
+    {
+        if (value < SUB_BUCKETS) return value;
+        size_t exponent = 63 - __builtin_clzll(value);
+        size_t sub = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    // 桶内最大值
+    static uint64_t bucketUpperBound(size_t bucket)
+    {
+        if (bucket < SUB_BUCKETS) return bucket;
+        size_t shift = bucket / SUB_BUCKETS - 1;
+        uint64_t lower = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return lower + (uint64_t(1) << shift) - 1;
+    }
+
+private:
+    static const size_t OP_COUNT = static_cast<size_t>(LatencyOp::COUNT);
+
+    static inline std::atomic<uint64_t> buckets_[OP_COUNT][BUCKET_COUNT];
+    static inline std::atomic<uint64_t> max_[OP_COUNT];
+};
+
+// 作用域计时，析构时记录
+class ScopedLatency
+{
+public:
+    explicit ScopedLatency(LatencyOp op) : op_(op), start_(LatencyHistogram::now()) {}
+    ~ScopedLatency() { LatencyHistogram::record(op_, LatencyHistogram::now() - start_); }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyOp op_;
+    uint64_t  start_;
+};
+
+#define KAMA_LATENCY_CONCAT_(a, b) a##b
+#define KAMA_LATENCY_CONCAT(a, b) KAMA_LATENCY_CONCAT_(a, b)
+
+#ifdef KAMA_LATENCY_HISTOGRAM
+#define KAMA_LATENCY_SCOPE(op) \
+    ::Kama_memoryPool::ScopedLatency KAMA_LATENCY_CONCAT(kamaLatency_, __LINE__)(::Kama_memoryPool::LatencyOp::op)
+#else
+#define KAMA_LATENCY_SCOPE(op) ((void)0)
+#endif
+
+} // namespace memoryPool
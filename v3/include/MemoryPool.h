@@ -1,5 +1,9 @@
 #pragma once
 #include "ThreadCache.h"
+#include "PageCache.h"
+#include "PoolStats.h"
+#include <cstdio>
+#include <new>
 
 namespace Kama_memoryPool
 {
@@ -16,6 +20,142 @@ public:
     {
         ThreadCache::getInstance()->deallocate(ptr, size);
     }
+
+    // 批量分配n个同样大小的内存块，返回实际分配的数量（内存不足时可能小于n）
+    static size_t allocateBatch(size_t size, void** out, size_t n)
+    {
+        return ThreadCache::getInstance()->allocateBatch(size, out, n);
+    }
+
+    // 批量释放n个同样大小的内存块
+    static void deallocateBatch(size_t size, void** ptrs, size_t n)
+    {
+        ThreadCache::getInstance()->deallocateBatch(size, ptrs, n);
+    }
+
+    // 无需大小的释放，大小通过页映射反查；非内存池分配的指针直接忽略
+    static void deallocate(void* ptr)
+    {
+        size_t size = getAllocSize(ptr);
+        if (size) deallocate(ptr, size);
+    }
+
+    // 查询ptr实际可用的字节数（即所属大小类的大小），非内存池分配的指针返回0
+    static size_t getAllocSize(void* ptr)
+    {
+        return ptr ? PageCache::objectSize(ptr) : 0;
+    }
+
+    // 调整内存块大小，新大小仍在原大小类内时返回原指针；
+    // 大对象优先原地扩展到相邻空闲页或mremap，避免拷贝
+    static void* reallocate(void* ptr, size_t oldSize, size_t newSize)
+    {
+        return ThreadCache::getInstance()->reallocate(ptr, oldSize, newSize);
+    }
+
+    // 无需旧大小的版本，结果须用无大小的deallocate(ptr)释放
+    static void* reallocate(void* ptr, size_t newSize)
+    {
+        if (!ptr) return allocate(newSize);
+        size_t usable = getAllocSize(ptr);
+        if (usable == 0) return nullptr;
+        // 小对象收缩不多时保留原块
+        if (usable <= MAX_BYTES && newSize <= usable && newSize > usable / 2)
+            return ptr;
+        return reallocate(ptr, usable, newSize);
+    }
+
+    // 按alignment对齐分配，alignment须为2的幂，否则返回nullptr。
+    // 不超过页大小的对齐取所在大小类；更大的对齐按大对象分配整页span，起点对齐到alignment
+    static void* allocateAligned(size_t size, size_t alignment)
+    {
+        if (!isValidAlignment(alignment) || size > ~size_t(0) - alignment - MAX_BYTES)
+            return nullptr;
+        if (alignment <= PageCache::PAGE_SIZE)
+            return ThreadCache::getInstance()->allocate(SizeClass::alignedSize(size, alignment));
+        return ThreadCache::getInstance()->allocatePageAligned(alignedAllocSize(size, alignment), alignment);
+    }
+
+    // 释放allocateAligned分配的内存，size和alignment须与分配时一致
+    static void deallocateAligned(void* ptr, size_t size, size_t alignment)
+    {
+        ThreadCache::getInstance()->deallocate(ptr, alignedAllocSize(size, alignment));
+    }
+
+    static bool isValidAlignment(size_t alignment)
+    {
+        return alignment != 0 && (alignment & (alignment - 1)) == 0;
+    }
+
+private:
+    // 对齐分配实际占用的字节数；超过页大小的对齐至少按大对象分配，释放时走页缓存
+    static size_t alignedAllocSize(size_t size, size_t alignment)
+    {
+        if (alignment <= PageCache::PAGE_SIZE)
+            return SizeClass::alignedSize(size, alignment);
+        return SizeClass::roundUp(std::max(size, MAX_BYTES + 1), PageCache::PAGE_SIZE);
+    }
+
+public:
+    // 汇总各层的统计信息，开销与线程数和大小类数成正比，不宜在热路径调用
+    static PoolStats getStats();
+
+    // 以可读格式输出统计信息
+    static void dumpStats(FILE* out);
+
+    // 供pthread_atfork注册：fork前按固定顺序取得所有内部锁，fork返回后在父子进程中释放，
+    // 避免fork时其他线程持有的锁在子进程中永远不被释放
+    static void prepareFork();
+    static void afterForkParent();
+    static void afterForkChild();
+};
+
+// 继承该类后，派生类的 new/delete（包括C++17对齐版本）都从内存池分配
+struct PoolAllocated
+{
+    static void* operator new(size_t size)
+    {
+        void* ptr = MemoryPool::allocate(size);
+        if (!ptr) throw std::bad_alloc();
+        return ptr;
+    }
+
+    static void* operator new(size_t size, std::align_val_t alignment)
+    {
+        void* ptr = MemoryPool::allocateAligned(size, static_cast<size_t>(alignment));
+        if (!ptr) throw std::bad_alloc();
+        return ptr;
+    }
+
+    static void* operator new[](size_t size)
+    {
+        return operator new(size);
+    }
+
+    static void* operator new[](size_t size, std::align_val_t alignment)
+    {
+        return operator new(size, alignment);
+    }
+
+    static void operator delete(void* ptr, size_t size)
+    {
+        if (ptr) MemoryPool::deallocate(ptr, size);
+    }
+
+    static void operator delete(void* ptr, size_t size, std::align_val_t alignment)
+    {
+        if (ptr) MemoryPool::deallocateAligned(ptr, size, static_cast<size_t>(alignment));
+    }
+
+    static void operator delete[](void* ptr, size_t size)
+    {
+        operator delete(ptr, size);
+    }
+
+    static void operator delete[](void* ptr, size_t size, std::align_val_t alignment)
+    {
+        operator delete(ptr, size, alignment);
+    }
 };
 
-} // namespace memoryPool
\ No newline at end of file
+} // namespace memoryPool
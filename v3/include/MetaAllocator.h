@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <sys/mman.h>
+#include <thread>
+
+namespace Kama_memoryPool
+{
+
+// 所有MetaAllocator实例共用一把自旋锁，fork前由MemoryPool::prepareFork统一取得
+class MetaAllocatorLock
+{
+public:
+    static void lock()
+    {
+        while (flag_.test_and_set(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+    }
+    static void unlock() { flag_.clear(std::memory_order_release); }
+
+private:
+    static inline std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+};
+
+// 内部元数据分配器（Span、map节点等）
+// 直接向系统mmap大块内存再切成定长对象，不经过malloc，
+// 这样内存池作为malloc替换库使用时内部不会递归调用自身。
+// 各NUMA分区的PageCache、ShardedHeap等会并发调用，空闲链表和切分游标由自旋锁保护
+template<typename T>
+class MetaAllocator
+{
+public:
+    using value_type = T;
+
+    MetaAllocator() = default;
+    template<typename U>
+    MetaAllocator(const MetaAllocator<U>&) {}
+
+    T* allocate(size_t n)
+    {
+        if (n != 1)
+        {
+            // 容器一般逐个申请节点，批量申请直接走mmap
+            void* mem = mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) throw std::bad_alloc();
+            return static_cast<T*>(mem);
+        }
+
+        Guard guard;
+        if (freeList_)
+        {
+            void* obj = freeList_;
+            freeList_ = *reinterpret_cast<void**>(obj);
+            return static_cast<T*>(obj);
+        }
+
+        if (cursor_ + OBJECT_SIZE > end_)
+        {
+            void* mem = mmap(nullptr, CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) throw std::bad_alloc();
+            cursor_ = static_cast<char*>(mem);
+            end_ = cursor_ + CHUNK_SIZE;
+        }
+
+        void* obj = cursor_;
+        cursor_ += OBJECT_SIZE;
+        return static_cast<T*>(obj);
+    }
+
+    void deallocate(T* ptr, size_t n)
+    {
+        if (n != 1)
+        {
+            munmap(ptr, n * sizeof(T));
+            return;
+        }
+        Guard guard;
+        *reinterpret_cast<void**>(ptr) = freeList_;
+        freeList_ = ptr;
+    }
+
+    template<typename U>
+    bool operator==(const MetaAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const MetaAllocator<U>&) const { return false; }
+
+private:
+    // 临界区只有几条指令，申请新块时mmap失败会抛异常，用RAII保证解锁
+    struct Guard
+    {
+        Guard() { MetaAllocatorLock::lock(); }
+        ~Guard() { MetaAllocatorLock::unlock(); }
+    };
+
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    // 对象至少能放下一个指针，并按指针大小对齐
+    static constexpr size_t OBJECT_SIZE =
+        (sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T) + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    // 每种类型一份全局状态，静态零初始化，无需构造
+    static inline void* freeList_ = nullptr;
+    static inline char* cursor_   = nullptr;
+    static inline char* end_      = nullptr;
+};
+
+} // namespace memoryPool
@@ -0,0 +1,47 @@
+#pragma once
+#include "Common.h"
+
+namespace Kama_memoryPool
+{
+
+// NUMA拓扑：页缓存和中心缓存按节点分区，线程按所在节点取用对应分区。
+// 单节点（UMA）机器上只有一个分区，各接口不做额外工作；
+// 环境变量KAMA_NUMA_NODES=N可指定分区数（1为关闭），便于在单节点机器上测试多分区
+class Numa
+{
+public:
+    static constexpr size_t MAX_NODES = 8;
+
+    // 分区数，首次调用时确定，之后不变
+    static size_t nodeCount()
+    {
+        static const size_t count = detectNodeCount();
+        return count;
+    }
+
+    // 当前线程所在的节点：优先使用pinThread指定的节点，否则由getcpu查询
+    static size_t currentNode()
+    {
+        if (KAMA_LIKELY(nodeCount() == 1)) return 0;
+        return pinnedNode_ != NOT_PINNED ? pinnedNode_ : queryCurrentNode();
+    }
+
+    // 把当前线程固定到某个分区（不改变CPU亲和性），用于测试以及自行安排线程位置的程序
+    static void pinThread(size_t node)
+    {
+        pinnedNode_ = node % nodeCount();
+    }
+
+    // 让[addr, addr + len)首次访问时优先从node分配物理页；节点不存在时忽略
+    static void bindToNode(void* addr, size_t len, size_t node);
+
+private:
+    static constexpr size_t NOT_PINNED = ~size_t(0);
+
+    static size_t detectNodeCount();
+    static size_t queryCurrentNode();
+
+    static inline thread_local size_t pinnedNode_ = NOT_PINNED;
+};
+
+} // namespace memoryPool
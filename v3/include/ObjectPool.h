@@ -0,0 +1,98 @@
+#pragma once
+#include "MemoryPool.h"
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace Kama_memoryPool
+{
+
+// 定类型对象池：大小类索引在编译期由sizeof(T)/alignof(T)确定，
+// 分配/释放直接内联为线程本地自由链表的弹出/压入
+template<typename T>
+class ObjectPool
+{
+    static_assert(alignof(T) <= PageCache::PAGE_SIZE, "ObjectPool: alignment exceeds page size");
+
+public:
+    static constexpr size_t ALIGN = alignof(T) > ALIGNMENT ? alignof(T) : ALIGNMENT;
+    // 对象实际占用的块大小，是ALIGN的倍数，所在大小类天然满足对齐
+    static constexpr size_t BLOCK_SIZE = SizeClass::alignedSize(sizeof(T), ALIGN);
+    static constexpr bool   USE_FREE_LIST = BLOCK_SIZE <= MAX_BYTES;
+    static constexpr size_t INDEX = SizeClass::getIndex(BLOCK_SIZE);
+
+    // 只分配内存，不构造对象
+    static void* allocate()
+    {
+        if constexpr (USE_FREE_LIST)
+            return ThreadCache::getInstance()->allocateByIndex(INDEX);
+        else
+            return MemoryPool::allocate(BLOCK_SIZE);
+    }
+
+    static void deallocate(void* ptr)
+    {
+        if constexpr (USE_FREE_LIST)
+            ThreadCache::getInstance()->deallocateByIndex(ptr, INDEX);
+        else
+            MemoryPool::deallocate(ptr, BLOCK_SIZE);
+    }
+
+    template<typename... Args>
+    static T* make(Args&&... args)
+    {
+        void* mem = allocate();
+        if (!mem) throw std::bad_alloc();
+        try
+        {
+            return new (mem) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            deallocate(mem);
+            throw;
+        }
+    }
+
+    // ptr的动态类型必须是T（不能通过基类指针释放派生类对象）
+    static void destroy(T* ptr)
+    {
+        if (ptr)
+        {
+            ptr->~T();
+            deallocate(ptr);
+        }
+    }
+};
+
+template<typename T>
+struct PoolDeleter
+{
+    void operator()(T* ptr) const
+    {
+        ObjectPool<T>::destroy(ptr);
+    }
+};
+
+template<typename T>
+using pool_unique_ptr = std::unique_ptr<T, PoolDeleter<T>>;
+
+template<typename T, typename... Args>
+T* make(Args&&... args)
+{
+    return ObjectPool<T>::make(std::forward<Args>(args)...);
+}
+
+template<typename T>
+void destroy(T* ptr)
+{
+    ObjectPool<T>::destroy(ptr);
+}
+
+template<typename T, typename... Args>
+pool_unique_ptr<T> make_pool_unique(Args&&... args)
+{
+    return pool_unique_ptr<T>(ObjectPool<T>::make(std::forward<Args>(args)...));
+}
+
+} // namespace memoryPool
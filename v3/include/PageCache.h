@@ -1,7 +1,12 @@
 #pragma once
 #include "Common.h"
-#include <map>
+#include "MetaAllocator.h"
+#include "Numa.h"
+#include "PageMap.h"
+#include "PoolStats.h"
+#include <cstdint>
 #include <mutex>
+#include <set>
 
 namespace Kama_memoryPool
 {
@@ -10,37 +15,160 @@ class PageCache
 {
 public:
     static const size_t PAGE_SIZE = 4096; // 4K页大小
+    static const size_t REMAP_THRESHOLD_PAGES = 256; // 不小于1MB的大块扩展时使用mremap
+    static const size_t NUM_BINS = 128; // 不超过128页的空闲span按页数精确分箱
+    static const size_t REGION_BYTES = size_t(64) << 30; // 启动时预留的连续地址空间
+    static const size_t COMMIT_PAGES = 512; // 预留区域每次至少提交2MB
 
+    // 当前线程所在节点的分区
     static PageCache& getInstance()
     {
-        static PageCache instance;
-        return instance;
+        return forNode(Numa::currentNode());
     }
 
-    // 分配指定页数的span
-    void* allocateSpan(size_t numPages);
+    // 每个NUMA节点一个分区，各自管理预留区域中的一段，单节点时只有一个分区。
+    // 分区永不析构：作为malloc替换库时，进程退出阶段仍可能有free调用到这里
+    static PageCache& forNode(size_t node)
+    {
+        static PageCache* partitions = createPartitions();
+        return partitions[node];
+    }
+
+    // fork前取得所有分区的锁，fork后在父子进程中释放
+    static void lockForFork();
+    static void unlockAfterFork();
+
+    // ptr所在span所属的分区，无锁；非内存池分配的地址返回0
+    static size_t nodeOf(void* ptr)
+    {
+        if (KAMA_LIKELY(Numa::nodeCount() == 1)) return 0;
+        Span* span = spanAt(pageIdOf(ptr));
+        return span ? span->node : 0;
+    }
+
+    // 标记ptr所在span为采样对象；释放时无需加锁查采样表即可排除绝大多数页对齐的块。
+    // ptr须为存活对象，其span在对象释放前不会变化，因此读写都无需加锁
+    static void markSampled(void* ptr)
+    {
+        if (Span* span = spanAt(pageIdOf(ptr))) span->sampled = true;
+    }
+    static bool isSampledSpan(void* ptr)
+    {
+        Span* span = spanAt(pageIdOf(ptr));
+        return span && span->sampled;
+    }
+
+    // 计算容纳bytes字节需要的页数
+    static size_t numPagesOf(size_t bytes)
+    {
+        return (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    }
+
+    // 分配指定页数的span，objSize为span内每个对象的大小（用于按指针反查大小）
+    void* allocateSpan(size_t numPages, size_t objSize = 0);
+
+    // 分配起始地址按alignment（页大小的整数倍，2的幂）对齐的span：多取alignment - PAGE_SIZE字节，
+    // 对齐点之前和之后多出的页作为空闲span放回
+    void* allocateAlignedSpan(size_t numPages, size_t alignment, size_t objSize);
 
-    // 释放span
+    // 释放span，其他分区的span转交所属分区
     void deallocateSpan(void* ptr, size_t numPages);
 
+    // 调整span大小：收缩或向后吞并相邻空闲span时原地完成，
+    // 超大块改用mremap（预留区域内的块搬到区域内另一处）；返回新地址，需要调用方拷贝时返回nullptr
+    void* reallocateSpan(void* ptr, size_t oldPages, size_t newPages);
+
+    // 查询ptr所在对象的大小，非内存池分配的地址返回0，无锁
+    static size_t objectSize(void* ptr);
+
+    // 累加本分区的空闲span总量和向系统映射/归还的字节数
+    void collectStats(PoolStats& stats);
+
 private:
-    PageCache() = default;
+    // 预留地址区域、建立其平坦页映射并按节点数平分给各分区，预留失败时所有span直接向系统申请
+    static PageCache* createPartitions();
+    // regionBase为nullptr表示没有预留区域
+    PageCache(size_t node, char* regionBase, size_t regionBytes);
 
-    // 向系统申请内存
+    // 预留区域不可用或用尽时直接向系统申请内存
     void* systemAlloc(size_t numPages);
 private:
     struct Span
     {
         void*  pageAddr; // 页起始地址
         size_t numPages; // 页数
-        Span*  next;     // 链表指针
+        Span*  prev;     // 空闲箱中的双向链表
+        Span*  next;
+        size_t objSize;  // 切分出的对象大小，空闲span为0
+        bool   isFree;   // 位于空闲箱或大span树中
+        bool   sampled;  // 整个span是一个被堆采样的对象
+        uint32_t node;   // 所属分区
+    };
+
+    // 大span树按（页数，地址）排序：lower_bound取到最小的足够大的span，同样大小时取低地址
+    struct SpanLess
+    {
+        bool operator()(const Span* a, const Span* b) const
+        {
+            if (a->numPages != b->numPages) return a->numPages < b->numPages;
+            return a->pageAddr < b->pageAddr;
+        }
     };
 
-    // 按页数管理空闲span，不同页数对应不同Span链表
-    std::map<size_t, Span*> freeSpans_;
-    // 页号到span的映射，用于回收
-    std::map<void*, Span*> spanMap_;
+    static size_t pageIdOf(void* addr)
+    {
+        return reinterpret_cast<uintptr_t>(addr) / PAGE_SIZE;
+    }
+
+    // 预留区域内的页查平坦映射，区域外的（直接mmap或mremap得到的）查基数树
+    static Span* spanAt(size_t pageId)
+    {
+        return regionMap_.contains(pageId) ? regionMap_.get(pageId) : pageMap_.get(pageId);
+    }
+    static void setSpan(size_t pageId, Span* span)
+    {
+        if (!regionMap_.set(pageId, span)) pageMap_.set(pageId, span);
+    }
+
+    Span* newSpan(void* pageAddr, size_t numPages);
+    void deleteSpan(Span* span);
+    // 归还span：与后面相邻的空闲span合并后放入空闲列表；紧邻区域顶部时并回顶部，
+    // 并连同顶部下方相邻的空闲span一起并回
+    void releaseSpan(Span* span);
+    // 清除span首尾页映射，把区域顶部降到span起始处并释放描述符
+    void lowerRegionTop(Span* span);
+    // 取得numPages页的span：依次尝试空闲span、预留区域顶部、直接向系统申请；调用方须持有锁
+    Span* getSpan(size_t numPages);
+    // 从预留区域顶部取numPages页，区域不可用或用尽时返回nullptr
+    void* takeRegionTop(size_t numPages);
+    // 预留区域内的超大块扩展：mremap到区域内另取的span，旧地址范围重新映射后回收
+    void* remapInRegion(Span* span, size_t newPages);
+    // 取出不少于numPages页的最小空闲span，没有时返回nullptr
+    Span* takeFreeSpan(size_t numPages);
+    // 从空闲列表摘除span，span不在空闲列表中时返回false
+    bool removeFreeSpan(Span* span);
+    void insertFreeSpan(Span* span);
+    // 登记span首尾页的映射，objSize不超过MAX_BYTES时登记所有页以便按块地址反查
+    void registerSpan(Span* span);
+
+    // 空闲span：不超过NUM_BINS页的按页数放入bins_[numPages - 1]，
+    // binBitmap_记录非空的箱，查找第一个足够大的箱只需一次ctz；更大的放入largeSpans_
+    Span*    bins_[NUM_BINS] = {};
+    uint64_t binBitmap_[NUM_BINS / 64] = {};
+    std::set<Span*, SpanLess, MetaAllocator<Span*>> largeSpans_;
+    // 页号到span的映射，用于回收和按地址反查大小
+    static FlatPageMap<Span> regionMap_;
+    static PageMap<Span> pageMap_;
+    size_t node_;
+    // 本分区的预留区域：[regionBase_, regionTop_)已分给span，[regionTop_, regionCommitted_)已提交
+    // 为可读写但未使用，其后为PROT_NONE。与顶部相邻的span释放时直接并回顶部
+    char* regionBase_ = nullptr;
+    char* regionTop_ = nullptr;
+    char* regionCommitted_ = nullptr;
+    char* regionEnd_ = nullptr;
     std::mutex mutex_;
+    size_t mappedBytes_ = 0;   // 累计向系统映射的字节数
+    size_t releasedBytes_ = 0; // 累计归还系统的字节数
 };
 
-} // namespace memoryPool
\ No newline at end of file
+} // namespace memoryPool
@@ -0,0 +1,120 @@
+#pragma once
+#include "Common.h"
+#include <sys/mman.h>
+
+namespace Kama_memoryPool
+{
+
+// 页号到Span的两级基数树，覆盖48位用户态地址空间
+// 读操作无锁；同一页的写操作由调用方（PageCache）加锁保护
+template<typename T>
+class PageMap
+{
+public:
+    static constexpr size_t ADDRESS_BITS = 48;
+    static constexpr size_t PAGE_SHIFT   = 12;
+    static constexpr size_t ROOT_BITS    = 18;
+    static constexpr size_t LEAF_BITS    = ADDRESS_BITS - PAGE_SHIFT - ROOT_BITS;
+    static constexpr size_t ROOT_LENGTH  = size_t(1) << ROOT_BITS;
+    static constexpr size_t LEAF_LENGTH  = size_t(1) << LEAF_BITS;
+
+    T* get(size_t pageId) const
+    {
+        size_t i1 = pageId >> LEAF_BITS;
+        if (i1 >= ROOT_LENGTH) return nullptr;
+        Leaf* leaf = root_[i1].load(std::memory_order_acquire);
+        if (!leaf) return nullptr;
+        return leaf->values[pageId & (LEAF_LENGTH - 1)].load(std::memory_order_acquire);
+    }
+
+    // 设置单页映射，叶子节点按需向系统申请（不经过malloc）
+    bool set(size_t pageId, T* value)
+    {
+        size_t i1 = pageId >> LEAF_BITS;
+        if (i1 >= ROOT_LENGTH) return false;
+        Leaf* leaf = root_[i1].load(std::memory_order_acquire);
+        if (!leaf)
+        {
+            void* mem = mmap(nullptr, sizeof(Leaf), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) return false;
+            // 各页缓存分区持有各自的锁，可能同时为同一段地址创建叶子，后到者改用已有的
+            Leaf* expected = nullptr;
+            if (root_[i1].compare_exchange_strong(expected, static_cast<Leaf*>(mem), std::memory_order_acq_rel))
+            {
+                leaf = static_cast<Leaf*>(mem);
+            }
+            else
+            {
+                munmap(mem, sizeof(Leaf));
+                leaf = expected;
+            }
+        }
+        leaf->values[pageId & (LEAF_LENGTH - 1)].store(value, std::memory_order_release);
+        return true;
+    }
+
+    // 设置连续numPages页的映射
+    bool setRange(size_t pageId, size_t numPages, T* value)
+    {
+        for (size_t i = 0; i < numPages; ++i)
+        {
+            if (!set(pageId + i, value)) return false;
+        }
+        return true;
+    }
+
+private:
+    // 叶子节点由mmap得到，初始内容全为0
+    struct Leaf
+    {
+        std::atomic<T*> values[LEAF_LENGTH];
+    };
+
+    // 根数组放在静态存储区，零初始化，只有被访问到的页才会占用物理内存
+    std::atomic<Leaf*> root_[ROOT_LENGTH];
+};
+
+// 覆盖一段连续地址区域的平坦页映射，按页号相对区域起点的偏移直接索引。
+// 数组用MAP_NORESERVE映射，只有写到的部分占用物理内存；读写约定同PageMap
+template<typename T>
+class FlatPageMap
+{
+public:
+    // 须在任何读写之前调用，失败时映射为空，contains总是返回false
+    bool init(size_t firstPage, size_t numPages)
+    {
+        void* mem = mmap(nullptr, numPages * sizeof(std::atomic<T*>), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mem == MAP_FAILED) return false;
+        values_ = static_cast<std::atomic<T*>*>(mem);
+        firstPage_ = firstPage;
+        numPages_ = numPages;
+        return true;
+    }
+
+    bool contains(size_t pageId) const
+    {
+        return pageId - firstPage_ < numPages_;
+    }
+
+    T* get(size_t pageId) const
+    {
+        if (!contains(pageId)) return nullptr;
+        return values_[pageId - firstPage_].load(std::memory_order_acquire);
+    }
+
+    bool set(size_t pageId, T* value)
+    {
+        if (!contains(pageId)) return false;
+        values_[pageId - firstPage_].store(value, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::atomic<T*>* values_ = nullptr;
+    size_t firstPage_ = 0;
+    size_t numPages_ = 0;
+};
+
+} // namespace memoryPool
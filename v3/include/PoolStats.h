@@ -0,0 +1,61 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace Kama_memoryPool
+{
+
+// 单个大小类的统计
+struct SizeClassStats
+{
+    size_t size;                // 块大小
+    size_t allocs;              // 分配次数
+    size_t frees;               // 释放次数
+    size_t refills;             // 线程缓存向中心缓存批量获取的次数
+    size_t drains;              // 线程缓存向中心缓存批量归还的次数
+    size_t threadCachedBlocks;  // 所有线程缓存中的空闲块数
+    size_t centralCachedBlocks; // 中心缓存中的空闲块数
+
+    // 分配在线程缓存中直接命中的比例
+    double hitRate() const
+    {
+        return allocs ? 1.0 - static_cast<double>(std::min(refills, allocs)) / allocs : 0.0;
+    }
+};
+
+// 内存池整体统计，由MemoryPool::getStats()生成。
+// 线程缓存的计数由各线程无锁累加、读取时汇总，数值是近似快照
+struct PoolStats
+{
+    std::vector<SizeClassStats> sizeClasses; // 只包含有过分配或缓存了空闲块的大小类
+
+    // 小对象（不超过MAX_BYTES）汇总
+    size_t allocs = 0;
+    size_t frees = 0;
+    size_t refills = 0;
+    size_t drains = 0;
+
+    // 大对象直接从页缓存分配
+    size_t largeAllocs = 0;
+    size_t largeFrees = 0;
+
+    // 各层缓存中空闲内存的字节数
+    size_t threadCacheBytes = 0;
+    size_t centralCacheBytes = 0;
+    size_t pageCacheFreeBytes = 0;
+    size_t pageCacheFreeSpans = 0;
+
+    // 向系统映射/归还的字节数
+    size_t mappedBytes = 0;
+    size_t releasedBytes = 0;
+
+    size_t threads = 0; // 当前登记的线程缓存数
+
+    double hitRate() const
+    {
+        return allocs ? 1.0 - static_cast<double>(std::min(refills, allocs)) / allocs : 0.0;
+    }
+};
+
+} // namespace memoryPool
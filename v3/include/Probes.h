@@ -0,0 +1,74 @@
+#pragma once
+
+// 静态探针（USDT），供perf/bpftrace在不重新编译的情况下跟踪各层之间的交互，例如：
+//   bpftrace -e 'usdt:./libkamamalloc.so:kamapool:thread_cache_miss { @[arg0] = count(); }'
+// 探针只是一条nop指令加ELF note，未挂载时几乎没有开销。
+// 有<sys/sdt.h>时直接使用；没有时在x86-64上用同样的note格式自行生成；
+// 定义KAMA_DISABLE_PROBES（CMake选项ENABLE_PROBES=OFF）时完全去除
+//
+// 探针列表（参数依次为arg0、arg1、arg2）：
+//   thread_cache_miss(size, batchNum)              ThreadCache自由链表为空，向中心缓存批量获取
+//   thread_cache_return(size, count)                ThreadCache归还多余的块给中心缓存
+//   central_fetch(size, batchNum, fetchedNum)      CentralCache交给ThreadCache一批块
+//   central_return(size, count, start)             CentralCache收回一批块
+//   central_refill(size, span, numPages)           CentralCache从PageCache获取新的span
+//   span_split(span, numPages, remainPages)        PageCache切分空闲span
+//   span_coalesce(span, numPages, mergedPages)     PageCache释放span时与后面的空闲span合并
+//   system_alloc(ptr, bytes)                       PageCache向系统申请内存
+//   system_remap(oldPtr, newPtr, bytes)            PageCache用mremap搬移大块，原映射归还系统
+
+#include <cstdint>
+
+#if defined(KAMA_DISABLE_PROBES)
+
+#define KAMA_PROBE2(name, a, b)    ((void)0)
+#define KAMA_PROBE3(name, a, b, c) ((void)0)
+
+#elif defined(__has_include) && __has_include(<sys/sdt.h>)
+
+#include <sys/sdt.h>
+#define KAMA_PROBE2(name, a, b)    DTRACE_PROBE2(kamapool, name, a, b)
+#define KAMA_PROBE3(name, a, b, c) DTRACE_PROBE3(kamapool, name, a, b, c)
+
+#elif defined(__x86_64__) && defined(__ELF__)
+
+// 与systemtap的sys/sdt.h相同的.note.stapsdt格式，参数统一按8字节无符号数放在寄存器中
+#define KAMA_SDT_ASM_(name, args)                                                      \
+    "990: nop\n"                                                                       \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                      \
+    ".balign 4\n"                                                                      \
+    ".4byte 992f-991f, 994f-993f, 3\n"                                                 \
+    "991: .asciz \"stapsdt\"\n"                                                        \
+    "992: .balign 4\n"                                                                 \
+    "993: .8byte 990b\n"                                                               \
+    ".8byte _.stapsdt.base\n"                                                          \
+    ".8byte 0\n"                                                                       \
+    ".asciz \"kamapool\"\n"                                                            \
+    ".asciz \"" #name "\"\n"                                                           \
+    ".asciz \"" args "\"\n"                                                            \
+    "994: .balign 4\n"                                                                 \
+    ".popsection\n"                                                                    \
+    ".ifndef _.stapsdt.base\n"                                                         \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"            \
+    ".weak _.stapsdt.base\n"                                                           \
+    ".hidden _.stapsdt.base\n"                                                         \
+    "_.stapsdt.base: .space 1\n"                                                       \
+    ".size _.stapsdt.base, 1\n"                                                        \
+    ".popsection\n"                                                                    \
+    ".endif\n"
+
+#define KAMA_PROBE_ARG_(x) "r"((uint64_t)(x))
+
+#define KAMA_PROBE2(name, a, b)                                                        \
+    __asm__ __volatile__(KAMA_SDT_ASM_(name, "8@%0 8@%1")                              \
+                         :: KAMA_PROBE_ARG_(a), KAMA_PROBE_ARG_(b))
+#define KAMA_PROBE3(name, a, b, c)                                                     \
+    __asm__ __volatile__(KAMA_SDT_ASM_(name, "8@%0 8@%1 8@%2")                         \
+                         :: KAMA_PROBE_ARG_(a), KAMA_PROBE_ARG_(b), KAMA_PROBE_ARG_(c))
+
+#else
+
+#define KAMA_PROBE2(name, a, b)    ((void)0)
+#define KAMA_PROBE3(name, a, b, c) ((void)0)
+
+#endif
@@ -0,0 +1,132 @@
+#pragma once
+#include "Common.h"
+#include "MemoryPool.h"
+#include "PageMap.h"
+
+namespace Kama_memoryPool
+{
+
+// 分片小对象堆（mimalloc式），与ThreadCache并列的另一种小对象引擎。
+// 每个线程按大小类持有若干“页”（8页span），每页有自己的空闲链表：
+//   freeList   可直接分配的块，只由所有者线程访问
+//   localFree  所有者线程释放的块，freeList取空时才并入（延迟收集）
+//   threadFree 其他线程释放的块，无锁压入，所有者在该页取空时一次性取回
+// 连续分配集中在同一页内，本线程释放不需要原子操作。
+// 不超过MAX_SMALL的对象走分片堆，更大的对象转交MemoryPool；
+// 指针须由ShardedHeap::allocate分配，释放时按页映射找到所属页
+class ShardedHeap
+{
+public:
+    static constexpr size_t MAX_SMALL   = 1024;
+    static constexpr size_t NUM_CLASSES = MAX_SMALL / ALIGNMENT;
+    static constexpr size_t SPAN_PAGES  = 8;
+
+    static void* allocate(size_t size)
+    {
+        if (KAMA_UNLIKELY(size - 1 >= MAX_SMALL))
+            return MemoryPool::allocate(size);
+
+        if (Heap* heap = tlsHeap_; KAMA_LIKELY(heap != nullptr))
+        {
+            Page* page = heap->pages[SizeClass::getIndex(size)];
+            if (KAMA_LIKELY(page != nullptr && page->freeList != nullptr))
+            {
+                void* block = page->freeList;
+                page->freeList = *reinterpret_cast<void**>(block);
+                page->used++;
+                return block;
+            }
+        }
+        return allocateSlow(size);
+    }
+
+    static void deallocate(void* ptr, size_t size)
+    {
+        if (KAMA_UNLIKELY(size - 1 >= MAX_SMALL))
+        {
+            MemoryPool::deallocate(ptr, size);
+            return;
+        }
+
+        Page* page = pageMap_.get(reinterpret_cast<uintptr_t>(ptr) / PageCache::PAGE_SIZE);
+        Heap* heap = tlsHeap_;
+        if (KAMA_LIKELY(heap != nullptr && page->heap.load(std::memory_order_relaxed) == heap))
+        {
+            *reinterpret_cast<void**>(ptr) = page->localFree;
+            page->localFree = ptr;
+            page->used--;
+            // 已满页需移回页队列；非当前页整页空闲时还给页缓存
+            if (KAMA_UNLIKELY(page->inFull || (page->used == 0 && heap->pages[page->index] != page)))
+                localFreeSlow(heap, page);
+            return;
+        }
+        remoteFree(page, ptr);
+    }
+
+    // 当前持有的页数（各线程与被遗弃的页），用于测试与观察
+    static size_t pageCount();
+
+    // fork前取得登记表的锁，fork后在父子进程中释放
+    static void lockForFork();
+    static void unlockAfterFork();
+
+private:
+    struct Heap;
+
+    // threadFree的最低位：页已满并移入所有者的已满链表，下一个远程释放者须通知所有者
+    static constexpr uintptr_t FULL_BIT = 1;
+
+    struct Page
+    {
+        void*                  freeList;
+        void*                  localFree;
+        std::atomic<uintptr_t> threadFree;
+        char*                  cursor;    // 尚未切分的区域[cursor, end)
+        char*                  end;
+        size_t                 blockSize;
+        size_t                 used;      // 已交出且尚未收回的块数，含已压入threadFree的块
+        size_t                 index;
+        std::atomic<Heap*>     heap;      // 所有者，nullptr表示所有者线程已退出
+        bool                   inFull;    // 在所有者的已满链表中
+        Page*                  prev;      // 所在的页队列或已满链表
+        Page*                  next;
+        void*                  start;
+    };
+
+    struct Heap
+    {
+        Page*               pages[NUM_CLASSES]; // 各大小类的页队列，队首为当前分配页
+        Page*               fullPages;          // 没有空闲块的页
+        std::atomic<size_t> pendingFull;        // 其他线程释放到已满页的次数
+        Heap*               nextFree;           // 线程退出后在复用链表中
+    };
+
+    // 页的创建与释放、被遗弃的页、线程退出后待复用的堆，见ShardedHeap.cpp
+    struct Registry;
+    static Registry& registry();
+
+    static void* allocateSlow(size_t size);
+    static void  localFreeSlow(Heap* heap, Page* page);
+    static void  remoteFree(Page* page, void* ptr);
+
+    static Heap* initHeap();
+    static void  onThreadExit(void* heap);
+    // 把localFree和threadFree并入freeList
+    static void  collect(Page* page);
+    // collect后仍为空时切分一批新块；页内无可用块时返回false
+    static bool  refillPage(Page* page);
+    // 把已满页中收到远程释放的移回页队列
+    static void  reclaimFullPages(Heap* heap);
+    static Page* newPage(Heap* heap, size_t index);
+    static Page* adoptPage(Heap* heap, size_t index);
+    // 调用方须持有Registry的锁
+    static void  releasePage(Page* page);
+
+    static void  pushFront(Page*& list, Page* page);
+    static void  unlink(Page*& list, Page* page);
+
+    static inline thread_local Heap* tlsHeap_ = nullptr;
+    static PageMap<Page> pageMap_;
+};
+
+} // namespace memoryPool
@@ -1,5 +1,8 @@
 #pragma once
 #include "Common.h"
+#include "HeapProfiler.h"
+#include "PoolStats.h"
+#include "TraceRecorder.h"
 
 namespace Kama_memoryPool 
 {
@@ -14,10 +17,122 @@ public:
         return &instance;
     }
 
-    void* allocate(size_t size);
-    void deallocate(void* ptr, size_t size);
+    // 命中路径内联在调用方：小对象、未到采样点、未记录轨迹且自由链表非空时直接弹出；
+    // 其余情况（0字节、大对象、采样、轨迹、链表为空）进入allocateSlow
+    void* allocate(size_t size)
+    {
+        if (KAMA_LIKELY(size - 1 < MAX_BYTES && size < bytesUntilSample_) && !TraceRecorder::enabled())
+        {
+            size_t index = SizeClass::getIndex(size);
+            if (void* ptr = freeList_[index]; KAMA_LIKELY(ptr != nullptr))
+            {
+                freeList_[index] = *reinterpret_cast<void**>(ptr);
+                freeListSize_[index]--;
+                allocCount_[index]++;
+                bytesUntilSample_ -= size;
+                return ptr;
+            }
+        }
+        return allocateSlow(size);
+    }
+
+    // 命中路径同样内联：压入线程本地自由链表，链表过长时才归还中心缓存
+    void deallocate(void* ptr, size_t size)
+    {
+        if (KAMA_UNLIKELY(size - 1 >= MAX_BYTES || TraceRecorder::enabled()))
+        {
+            deallocateSlow(ptr, size);
+            return;
+        }
+        if (KAMA_UNLIKELY(HeapProfiler::removeIfSampled(ptr)))
+        {
+            freeSampled(ptr, size);
+            return;
+        }
+
+        size_t index = SizeClass::getIndex(size);
+        *reinterpret_cast<void**>(ptr) = freeList_[index];
+        freeList_[index] = ptr;
+        freeListSize_[index]++;
+        if (KAMA_UNLIKELY(shouldReturnToCentralCache(index)))
+        {
+            returnToCentralCache(ptr, size);
+        }
+    }
+
+    // 批量分配n个size大小的内存块写入out，返回实际分配的数量
+    size_t allocateBatch(size_t size, void** out, size_t n);
+    // 批量释放n个size大小的内存块
+    void deallocateBatch(size_t size, void** ptrs, size_t n);
+    // 调整内存块大小，能原地完成时返回原指针
+    void* reallocate(void* ptr, size_t oldSize, size_t newSize);
+    // 对齐超过页大小的分配：size须大于MAX_BYTES且为页大小的整数倍，按大对象释放
+    void* allocatePageAligned(size_t size, size_t alignment);
+
+    // 大小类索引已知时的分配/释放，供ObjectPool等在编译期确定索引的调用方内联使用
+    void* allocateByIndex(size_t index)
+    {
+        size_t size = (index + 1) * ALIGNMENT;
+        if (KAMA_UNLIKELY(size >= bytesUntilSample_ || TraceRecorder::enabled()))
+            return allocateSlow(size);
+        bytesUntilSample_ -= size;
+
+        allocCount_[index]++;
+        freeListSize_[index]--;
+        if (void* ptr = freeList_[index]; KAMA_LIKELY(ptr != nullptr))
+        {
+            freeList_[index] = *reinterpret_cast<void**>(ptr);
+            return ptr;
+        }
+        return fetchFromCentralCache(index);
+    }
+
+    // 汇总所有线程缓存（含已退出线程）的分配次数和缓存块数
+    static void collectStats(PoolStats& stats);
+
+    // fork前取得线程缓存登记表的锁，fork后在父子进程中释放
+    static void lockForFork();
+    static void unlockAfterFork();
+
+    void deallocateByIndex(void* ptr, size_t index)
+    {
+        if (KAMA_UNLIKELY(TraceRecorder::enabled()))
+            TraceRecorder::record(TraceOp::FREE, (index + 1) * ALIGNMENT, ptr);
+        if (KAMA_UNLIKELY(HeapProfiler::removeIfSampled(ptr)))
+        {
+            freeSampled(ptr, (index + 1) * ALIGNMENT);
+            return;
+        }
+        *reinterpret_cast<void**>(ptr) = freeList_[index];
+        freeList_[index] = ptr;
+        freeListSize_[index]++;
+        if (KAMA_UNLIKELY(shouldReturnToCentralCache(index)))
+        {
+            returnToCentralCache(freeList_[index], (index + 1) * ALIGNMENT);
+        }
+    }
 private:
     ThreadCache() = default;
+    // 首次与中心缓存交互时登记到全局线程缓存链表，供统计汇总
+    void registerThread()
+    {
+        if (!registered_) registerThreadSlow();
+    }
+    void registerThreadSlow();
+    // 线程退出：空闲块全部还给中心缓存，计数并入全局
+    static void onThreadExit(void* cache);
+    // 不经过采样计数的分配
+    void* allocateFromCache(size_t size);
+    // allocate未命中时的完整路径：0字节、大对象、采样倒计时到期、记录轨迹或自由链表为空
+    void* allocateSlow(size_t size);
+    // deallocate的完整路径：大对象、0字节或正在记录轨迹
+    void deallocateSlow(void* ptr, size_t size);
+    // 采样倒计时到期：重新计算间隔，开启了堆分析时记录本次分配
+    void* sampleAllocation(size_t size);
+    // 释放已从采样表中移除的对象
+    void freeSampled(void* ptr, size_t size);
+    // 下一次采样前的分配字节数，服从均值为sampleRate的指数分布
+    size_t nextSampleInterval(size_t sampleRate);
     // 从中心缓存获取内存
     void* fetchFromCentralCache(size_t index);
     // 归还内存到中心缓存
@@ -25,11 +140,30 @@ private:
     // 计算批量获取内存块的数量
     size_t getBatchNum(size_t size);
     // 判断是否需要归还内存给中心缓存
-    bool shouldReturnToCentralCache(size_t index);
+    bool shouldReturnToCentralCache(size_t index)
+    {
+        // 设定阈值，例如：当自由链表的大小超过一定数量时
+        constexpr size_t threshold = 64; // 例如，64个内存块
+        return (freeListSize_[index] > threshold);
+    }
 private:
     // 每个线程的自由链表数组
     std::array<void*, FREE_LIST_SIZE> freeList_;    
     std::array<size_t, FREE_LIST_SIZE> freeListSize_; // 自由链表大小统计
+    std::array<size_t, FREE_LIST_SIZE> allocCount_;   // 各大小类分配次数，只由本线程写
+    size_t largeAllocCount_;
+    size_t largeFreeCount_;
+
+    // 已登记线程缓存的双向链表
+    ThreadCache* prev_;
+    ThreadCache* next_;
+    bool registered_;
+    bool retired_; // 线程已退出，不再重新登记
+
+    // 堆采样，初始为0使每个线程的第一次分配进入采样路径完成初始化
+    size_t   bytesUntilSample_;
+    uint64_t sampleRandom_; // 生成采样间隔的随机数状态
+    bool     inSample_;     // 采样过程中（如backtrace内部）的分配不再采样
 };
 
 } // namespace memoryPool
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Kama_memoryPool
+{
+
+enum class TraceOp : uint8_t
+{
+    ALLOC = 0,
+    FREE  = 1,
+};
+
+// 轨迹文件中的一条记录，24字节
+struct TraceRecord
+{
+    uint64_t timestamp; // LatencyHistogram::now()的计数，只用于排序
+    uint64_t ptr;       // 对象地址，回放时按出现顺序换算成对象编号
+    uint32_t size;
+    uint16_t thread;    // 记录线程的编号，从0开始
+    uint8_t  op;        // TraceOp
+    uint8_t  reserved;
+};
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord must stay 24 bytes");
+
+// 轨迹文件头，之后紧跟TraceRecord数组。各线程的记录分块写入，回放时按时间戳归并
+struct TraceHeader
+{
+    char     magic[8];   // "KAMATRC1"
+    uint32_t recordSize; // sizeof(TraceRecord)
+    uint32_t reserved;
+};
+
+// 分配轨迹记录器：开启后ThreadCache的每次分配/释放都写入线程私有缓冲区，
+// 缓冲区满时整块写入文件。realloc记为一次释放加一次分配
+class TraceRecorder
+{
+public:
+    // 开始记录到path，已在记录时返回false
+    static bool start(const char* path);
+    // 停止记录，写出所有线程缓冲区中剩余的记录
+    static void stop();
+
+    static bool enabled()
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    static void record(TraceOp op, size_t size, void* ptr);
+
+    // fork前取得记录器的锁；父进程中直接释放，子进程中停止记录并丢弃从父进程复制来的缓冲区，
+    // 避免同一批记录被父子进程重复写出
+    static void lockForFork();
+    static void unlockAfterForkParent();
+    static void unlockAfterForkChild();
+
+private:
+    static inline std::atomic<bool> enabled_{false};
+};
+
+} // namespace memoryPool
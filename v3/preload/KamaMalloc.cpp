@@ -0,0 +1,323 @@
+// libkamamalloc.so：用内存池替换 malloc/free/new/delete
+// 用法：LD_PRELOAD=./libkamamalloc.so ./your_program
+#include "../include/MemoryPool.h"
+#include "../include/HeapProfiler.h"
+#include "../include/TraceRecorder.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <pthread.h>
+
+#define KAMA_EXPORT __attribute__((visibility("default")))
+
+using namespace Kama_memoryPool;
+
+namespace
+{
+
+// malloc/new 需要满足基础对齐（16字节）：
+// 大于8字节的请求取整到16的倍数，所在大小类天然16字节对齐
+constexpr size_t MALLOC_ALIGNMENT = 16;
+
+inline size_t mallocSize(size_t size)
+{
+    return size <= ALIGNMENT ? size : SizeClass::roundUp(size, MALLOC_ALIGNMENT);
+}
+
+// 与glibc一致，超过PTRDIFF_MAX的请求直接失败，也避免取整和换算页数时溢出
+inline bool tooLarge(size_t size)
+{
+    return size > static_cast<size_t>(PTRDIFF_MAX);
+}
+
+inline void* poolMalloc(size_t size)
+{
+    if (tooLarge(size))
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    void* ptr = MemoryPool::allocate(mallocSize(size));
+    if (!ptr) errno = ENOMEM;
+    return ptr;
+}
+
+inline void* poolMemalign(size_t alignment, size_t size)
+{
+    if (alignment <= MALLOC_ALIGNMENT)
+        return poolMalloc(size);
+    void* ptr = MemoryPool::allocateAligned(size, alignment);
+    if (!ptr) errno = ENOMEM;
+    return ptr;
+}
+
+inline void* poolNew(size_t size)
+{
+    if (tooLarge(size)) throw std::bad_alloc();
+    void* ptr = MemoryPool::allocate(mallocSize(size));
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+inline void* poolNewAligned(size_t size, std::align_val_t alignment)
+{
+    void* ptr = poolMemalign(static_cast<size_t>(alignment), size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+// 带大小的delete可以省去一次页映射查询
+inline void poolSizedDelete(void* ptr, size_t size)
+{
+    if (ptr) MemoryPool::deallocate(ptr, mallocSize(size));
+}
+
+// 设置KAMA_HEAP_PROFILE=文件路径时开启堆采样，进程退出时写出pprof格式的堆分析文件；
+// 采样间隔（字节）可用KAMA_HEAP_SAMPLE_RATE调整
+const char* heapProfilePath = nullptr;
+
+void writeHeapProfileAtExit()
+{
+    if (FILE* out = fopen(heapProfilePath, "w"))
+    {
+        HeapProfiler::writeHeapProfile(out);
+        fclose(out);
+    }
+}
+
+void stopTraceAtExit()
+{
+    TraceRecorder::stop();
+}
+
+// 设置KAMA_TRACE=文件路径时记录分配轨迹，供replay_bench回放
+__attribute__((constructor)) void initFromEnvironment()
+{
+    // 多线程程序fork（如popen、subprocess）时其他线程可能正持有内存池的锁
+    pthread_atfork(MemoryPool::prepareFork, MemoryPool::afterForkParent, MemoryPool::afterForkChild);
+
+    heapProfilePath = getenv("KAMA_HEAP_PROFILE");
+    if (heapProfilePath && *heapProfilePath)
+    {
+        const char* rate = getenv("KAMA_HEAP_SAMPLE_RATE");
+        HeapProfiler::start(rate ? strtoull(rate, nullptr, 10) : HeapProfiler::DEFAULT_SAMPLE_RATE);
+        atexit(writeHeapProfileAtExit);
+    }
+
+    const char* tracePath = getenv("KAMA_TRACE");
+    if (tracePath && *tracePath && TraceRecorder::start(tracePath))
+    {
+        atexit(stopTraceAtExit);
+    }
+}
+
+} // namespace
+
+extern "C"
+{
+
+KAMA_EXPORT void* malloc(size_t size)
+{
+    return poolMalloc(size);
+}
+
+KAMA_EXPORT void free(void* ptr)
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void* calloc(size_t num, size_t size)
+{
+    size_t total;
+    if (__builtin_mul_overflow(num, size, &total))
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    // 复用的内存块不保证为0
+    void* ptr = poolMalloc(total);
+    if (ptr) memset(ptr, 0, total);
+    return ptr;
+}
+
+KAMA_EXPORT void* realloc(void* ptr, size_t size)
+{
+    if (!ptr) return poolMalloc(size);
+    if (size == 0)
+    {
+        MemoryPool::deallocate(ptr);
+        return nullptr;
+    }
+    if (tooLarge(size))
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    void* newPtr = MemoryPool::reallocate(ptr, mallocSize(size));
+    if (!newPtr) errno = ENOMEM;
+    return newPtr;
+}
+
+KAMA_EXPORT void* reallocarray(void* ptr, size_t num, size_t size)
+{
+    size_t total;
+    if (__builtin_mul_overflow(num, size, &total))
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return realloc(ptr, total);
+}
+
+KAMA_EXPORT int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    void* ptr = poolMemalign(alignment, size);
+    if (!ptr) return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+KAMA_EXPORT void* aligned_alloc(size_t alignment, size_t size)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return poolMemalign(alignment, size);
+}
+
+KAMA_EXPORT void* memalign(size_t alignment, size_t size)
+{
+    return aligned_alloc(alignment, size);
+}
+
+KAMA_EXPORT void* valloc(size_t size)
+{
+    return poolMemalign(PageCache::PAGE_SIZE, size);
+}
+
+KAMA_EXPORT void* pvalloc(size_t size)
+{
+    return poolMemalign(PageCache::PAGE_SIZE,
+                        SizeClass::roundUp(size ? size : 1, PageCache::PAGE_SIZE));
+}
+
+KAMA_EXPORT size_t malloc_usable_size(void* ptr)
+{
+    return MemoryPool::getAllocSize(ptr);
+}
+
+// 与glibc一致，统计信息输出到stderr
+KAMA_EXPORT void malloc_stats(void)
+{
+    MemoryPool::dumpStats(stderr);
+}
+
+} // extern "C"
+
+KAMA_EXPORT void* operator new(size_t size)
+{
+    return poolNew(size);
+}
+
+KAMA_EXPORT void* operator new[](size_t size)
+{
+    return poolNew(size);
+}
+
+KAMA_EXPORT void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return poolMalloc(size);
+}
+
+KAMA_EXPORT void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return poolMalloc(size);
+}
+
+KAMA_EXPORT void* operator new(size_t size, std::align_val_t alignment)
+{
+    return poolNewAligned(size, alignment);
+}
+
+KAMA_EXPORT void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return poolNewAligned(size, alignment);
+}
+
+KAMA_EXPORT void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return poolMemalign(static_cast<size_t>(alignment), size);
+}
+
+KAMA_EXPORT void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return poolMemalign(static_cast<size_t>(alignment), size);
+}
+
+KAMA_EXPORT void operator delete(void* ptr) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void operator delete[](void* ptr) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void operator delete(void* ptr, size_t size) noexcept
+{
+    poolSizedDelete(ptr, size);
+}
+
+KAMA_EXPORT void operator delete[](void* ptr, size_t size) noexcept
+{
+    poolSizedDelete(ptr, size);
+}
+
+// 对齐版本的大小取决于对齐数，统一按页映射反查
+KAMA_EXPORT void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void operator delete[](void* ptr, size_t, std::align_val_t) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
+
+KAMA_EXPORT void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    MemoryPool::deallocate(ptr);
+}
@@ -0,0 +1,149 @@
+#include "../include/Arena.h"
+#include "../include/PageCache.h"
+
+namespace Kama_memoryPool
+{
+
+Arena::Arena(size_t chunkPages, size_t keepChunks)
+    : current_(nullptr)
+    , cursor_(nullptr)
+    , end_(nullptr)
+    , spare_(nullptr)
+    , chunkPages_(std::max(chunkPages, size_t(1)))
+    , keepChunks_(keepChunks)
+{}
+
+Arena::~Arena()
+{
+    keepChunks_ = 0;
+    reset();
+}
+
+char* Arena::chunkEnd(Chunk* chunk)
+{
+    return reinterpret_cast<char*>(chunk) + chunk->numPages * PageCache::PAGE_SIZE;
+}
+
+void* Arena::allocateSlow(size_t size, size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > PageCache::PAGE_SIZE)
+        return nullptr;
+
+    // 当前span剩余空间不够，换一个新的span（剩余空间直接放弃）
+    Chunk* chunk = obtainChunk(size + alignment);
+    if (!chunk) return nullptr;
+
+    chunk->prev = current_;
+    current_ = chunk;
+    cursor_ = chunkBegin(chunk);
+    end_ = chunkEnd(chunk);
+
+    return allocate(size, alignment);
+}
+
+Arena::Chunk* Arena::obtainChunk(size_t minBytes)
+{
+    // 先在保留的span中找能放下的
+    Chunk** link = &spare_;
+    while (*link)
+    {
+        Chunk* chunk = *link;
+        if (static_cast<size_t>(chunkEnd(chunk) - chunkBegin(chunk)) >= minBytes)
+        {
+            *link = chunk->prev;
+            return chunk;
+        }
+        link = &chunk->prev;
+    }
+
+    size_t numPages = std::max(chunkPages_, PageCache::numPagesOf(minBytes + sizeof(Chunk)));
+    void* mem = PageCache::getInstance().allocateSpan(numPages);
+    if (!mem) return nullptr;
+
+    Chunk* chunk = static_cast<Chunk*>(mem);
+    chunk->prev = nullptr;
+    chunk->numPages = numPages;
+    return chunk;
+}
+
+void Arena::releaseChunk(Chunk* chunk)
+{
+    PageCache::getInstance().deallocateSpan(chunk, chunk->numPages);
+}
+
+void Arena::rewind(const Checkpoint& checkpoint)
+{
+    // 检查点之后申请的span放入保留链表，马上还会被用到
+    while (current_ != checkpoint.chunk)
+    {
+        Chunk* chunk = current_;
+        current_ = chunk->prev;
+        chunk->prev = spare_;
+        spare_ = chunk;
+    }
+
+    cursor_ = checkpoint.cursor;
+    end_ = current_ ? chunkEnd(current_) : nullptr;
+}
+
+void Arena::reset()
+{
+    rewind(Checkpoint{nullptr, nullptr});
+    trimSpare();
+}
+
+void Arena::trimSpare()
+{
+    // 按页数从大到小维护最多keepChunks_个span，挤出来的归还PageCache
+    Chunk* kept = nullptr;
+    size_t keptNum = 0;
+
+    Chunk* chunk = spare_;
+    while (chunk)
+    {
+        Chunk* next = chunk->prev;
+
+        Chunk** link = &kept;
+        while (*link && (*link)->numPages >= chunk->numPages)
+        {
+            link = &(*link)->prev;
+        }
+        chunk->prev = *link;
+        *link = chunk;
+        keptNum++;
+
+        if (keptNum > keepChunks_)
+        {
+            // 去掉最小的一个
+            Chunk** tail = &kept;
+            while ((*tail)->prev)
+            {
+                tail = &(*tail)->prev;
+            }
+            Chunk* smallest = *tail;
+            *tail = nullptr;
+            releaseChunk(smallest);
+            keptNum--;
+        }
+
+        chunk = next;
+    }
+
+    spare_ = kept;
+}
+
+size_t Arena::bytesReserved() const
+{
+    size_t bytes = 0;
+    for (Chunk* chunk = current_; chunk; chunk = chunk->prev)
+    {
+        bytes += chunk->numPages * PageCache::PAGE_SIZE;
+    }
+    for (Chunk* chunk = spare_; chunk; chunk = chunk->prev)
+    {
+        bytes += chunk->numPages * PageCache::PAGE_SIZE;
+    }
+    return bytes;
+}
+
+} // namespace memoryPool
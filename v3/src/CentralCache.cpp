@@ -1,5 +1,7 @@
 #include "../include/CentralCache.h"
 #include "../include/PageCache.h"
+#include "../include/LatencyHistogram.h"
+#include "../include/Probes.h"
 #include <cassert>
 #include <thread>
 
@@ -9,8 +11,46 @@ namespace Kama_memoryPool
 // 每次从PageCache获取span大小（以页为单位）
 static const size_t SPAN_PAGES = 8;
 
-void* CentralCache::fetchRange(size_t index, size_t batchNum)
+CentralCache* CentralCache::createPartitions()
 {
+    alignas(CentralCache) static char storage[Numa::MAX_NODES][sizeof(CentralCache)];
+    for (size_t node = 0; node < Numa::nodeCount(); ++node)
+    {
+        new (storage[node]) CentralCache(node);
+    }
+    return reinterpret_cast<CentralCache*>(storage);
+}
+
+void CentralCache::lockForFork()
+{
+    for (size_t node = 0; node < Numa::nodeCount(); ++node)
+    {
+        for (auto& lock : forNode(node).locks_)
+        {
+            while (lock.test_and_set(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+void CentralCache::unlockAfterFork()
+{
+    for (size_t node = 0; node < Numa::nodeCount(); ++node)
+    {
+        for (auto& lock : forNode(node).locks_)
+        {
+            lock.clear(std::memory_order_release);
+        }
+    }
+}
+
+void* CentralCache::fetchRange(size_t index, size_t batchNum, size_t& fetchedNum)
+{
+    KAMA_LATENCY_SCOPE(CENTRAL_FETCH_RANGE);
+    fetchedNum = 0;
+
     // 索引检查，当索引大于等于FREE_LIST_SIZE时，说明申请内存过大应直接向系统申请
     if (index >= FREE_LIST_SIZE || batchNum == 0) 
         return nullptr;
@@ -24,76 +64,58 @@ void* CentralCache::fetchRange(size_t index, size_t batchNum)
     void* result = nullptr;
     try 
     {
-        // 尝试从中心缓存获取内存块
+        // 先从中心缓存现有链表中取，最多batchNum个
         result = centralFreeList_[index].load(std::memory_order_relaxed);
+        void* current = result;
+        void* prev = nullptr;
+        size_t count = 0;
 
-        if (!result)
+        while (current && count < batchNum)
         {
-            // 如果中心缓存为空，从页缓存获取新的内存块
-            size_t size = (index + 1) * ALIGNMENT;
-            result = fetchFromPageCache(size);
+            prev = current;
+            current = *reinterpret_cast<void**>(current);
+            count++;
+        }
 
-            if (!result)
-            {
-                locks_[index].clear(std::memory_order_release);
-                return nullptr;
-            }
+        if (prev) // 当前centralFreeList_[index]链表上的内存块大于batchNum时需要用到 
+        {
+            *reinterpret_cast<void**>(prev) = nullptr;
+        }
 
-            // 将从PageCache获取的内存块切分成小块
-            char* start = static_cast<char*>(result);
-            size_t totalBlocks = (SPAN_PAGES * PageCache::PAGE_SIZE) / size;
-            size_t allocBlocks = std::min(batchNum, totalBlocks);
-            
-            // 构建返回给ThreadCache的内存块链表
-            if (allocBlocks > 1) 
-            {  
-                // 确保至少有两个块才构建链表
-                // 构建链表
-                for (size_t i = 1; i < allocBlocks; ++i) 
-                {
-                    void* current = start + (i - 1) * size;
-                    void* next = start + i * size;
-                    *reinterpret_cast<void**>(current) = next;
-                }
-                *reinterpret_cast<void**>(start + (allocBlocks - 1) * size) = nullptr;
-            }
+        centralFreeList_[index].store(current, std::memory_order_release);
 
-            // 构建保留在CentralCache的链表
-            if (totalBlocks > allocBlocks)
-            {
-                void* remainStart = start + allocBlocks * size;
-                for (size_t i = allocBlocks + 1; i < totalBlocks; ++i)
-                {
-                    void* current = start + (i - 1) * size;
-                    void* next = start + i * size;
-                    *reinterpret_cast<void**>(current) = next;
-                }
-                *reinterpret_cast<void**>(start + (totalBlocks - 1) * size) = nullptr;
-
-                centralFreeList_[index].store(remainStart, std::memory_order_release);
-            }
-        } 
-        else // 如果中心缓存有index对应大小的内存块
+        // 中心缓存不够时，从待切分区域顺序切出，区域用完再向页缓存获取新的span，均在同一次加锁内
+        size_t size = (index + 1) * ALIGNMENT;
+        while (count < batchNum)
         {
-            // 从现有链表中获取指定数量的块
-            void* current = result;
-            void* prev = nullptr;
-            size_t count = 0;
-
-            while (current && count < batchNum)
-            {
-                prev = current;
-                current = *reinterpret_cast<void**>(current);
-                count++;
-            }
+            SpanCursor& span = spanCursors_[index];
+            if (static_cast<size_t>(span.end - span.cursor) < size && !refillSpan(index, size))
+                break;
 
-            if (prev) // 当前centralFreeList_[index]链表上的内存块大于batchNum时需要用到 
+            size_t carveNum = std::min(batchNum - count, static_cast<size_t>(span.end - span.cursor) / size);
+            char* start = span.cursor;
+            // 只为交出的块构建链表，接在已取到的链表之后
+            for (size_t i = 1; i < carveNum; ++i)
             {
-                *reinterpret_cast<void**>(prev) = nullptr;
+                *reinterpret_cast<void**>(start + (i - 1) * size) = start + i * size;
             }
+            char* last = start + (carveNum - 1) * size;
+            *reinterpret_cast<void**>(last) = nullptr;
+            span.cursor += carveNum * size;
 
-            centralFreeList_[index].store(current, std::memory_order_release);
+            if (prev)
+                *reinterpret_cast<void**>(prev) = start;
+            else
+                result = start;
+            prev = last;
+            count += carveNum;
         }
+        counters_[index].freeBlocks -= count;
+
+        fetchedNum = count;
+        counters_[index].fetches++;
+        counters_[index].fetchedBlocks += count;
+        KAMA_PROBE3(central_fetch, (index + 1) * ALIGNMENT, batchNum, count);
     }
     catch (...) 
     {
@@ -106,12 +128,40 @@ void* CentralCache::fetchRange(size_t index, size_t batchNum)
     return result;
 }
 
-void CentralCache::returnRange(void* start, size_t size, size_t index)
+void CentralCache::returnRange(void* start, size_t count, size_t index)
 {
+    KAMA_LATENCY_SCOPE(CENTRAL_RETURN_RANGE);
     // 当索引大于等于FREE_LIST_SIZE时，说明内存过大应直接向系统归还
     if (!start || index >= FREE_LIST_SIZE) 
         return;
 
+    if (KAMA_LIKELY(Numa::nodeCount() == 1))
+    {
+        pushRange(start, count, index);
+        return;
+    }
+
+    // 按块所在span的分区拆成多条链表，各自还给所属分区
+    void* heads[Numa::MAX_NODES] = {};
+    size_t counts[Numa::MAX_NODES] = {};
+    void* current = start;
+    for (size_t i = 0; current && i < count; ++i)
+    {
+        void* next = *reinterpret_cast<void**>(current);
+        size_t node = PageCache::nodeOf(current);
+        *reinterpret_cast<void**>(current) = heads[node];
+        heads[node] = current;
+        counts[node]++;
+        current = next;
+    }
+    for (size_t node = 0; node < Numa::nodeCount(); ++node)
+    {
+        if (heads[node]) forNode(node).pushRange(heads[node], counts[node], index);
+    }
+}
+
+void CentralCache::pushRange(void* start, size_t count, size_t index)
+{
     while (locks_[index].test_and_set(std::memory_order_acquire)) 
     {
         std::this_thread::yield();
@@ -121,16 +171,21 @@ void CentralCache::returnRange(void* start, size_t size, size_t index)
     {
         // 找到要归还的链表的最后一个节点
         void* end = start;
-        size_t count = 1;
-        while (*reinterpret_cast<void**>(end) != nullptr && count < size) {
+        size_t num = 1;
+        while (*reinterpret_cast<void**>(end) != nullptr && num < count) {
             end = *reinterpret_cast<void**>(end);
-            count++;
+            num++;
         }
 
         // 将归还的链表连接到中心缓存的链表头部
         void* current = centralFreeList_[index].load(std::memory_order_relaxed);
         *reinterpret_cast<void**>(end) = current;  // 将原链表头接到归还链表的尾部
         centralFreeList_[index].store(start, std::memory_order_release);  // 将归还的链表头设为新的链表头
+
+        counters_[index].freeBlocks += num;
+        counters_[index].returns++;
+        counters_[index].returnedBlocks += num;
+        KAMA_PROBE3(central_return, (index + 1) * ALIGNMENT, num, start);
     }
     catch (...) 
     {
@@ -141,8 +196,59 @@ void CentralCache::returnRange(void* start, size_t size, size_t index)
     locks_[index].clear(std::memory_order_release);
 }
 
+void CentralCache::collectStats(PoolStats& stats)
+{
+    for (size_t index = 0; index < FREE_LIST_SIZE; ++index)
+    {
+        ClassCounters counters = {};
+        for (size_t node = 0; node < Numa::nodeCount(); ++node)
+        {
+            CentralCache& central = forNode(node);
+            while (central.locks_[index].test_and_set(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            const ClassCounters& partition = central.counters_[index];
+            counters.freeBlocks += partition.freeBlocks;
+            counters.fetches += partition.fetches;
+            counters.fetchedBlocks += partition.fetchedBlocks;
+            counters.returns += partition.returns;
+            counters.returnedBlocks += partition.returnedBlocks;
+            central.locks_[index].clear(std::memory_order_release);
+        }
+
+        SizeClassStats& cls = stats.sizeClasses[index];
+        cls.refills = counters.fetches;
+        cls.drains = counters.returns;
+        cls.centralCachedBlocks = counters.freeBlocks;
+
+        // 线程缓存中的块数 = 取到的 - 归还的 + 释放的 - 分配的，由此推算释放次数，
+        // 释放路径上无需再单独计数
+        ptrdiff_t frees = static_cast<ptrdiff_t>(cls.allocs + cls.threadCachedBlocks + counters.returnedBlocks)
+                        - static_cast<ptrdiff_t>(counters.fetchedBlocks);
+        cls.frees = frees > 0 ? static_cast<size_t>(frees) : 0;
+    }
+}
+
+bool CentralCache::refillSpan(size_t index, size_t size)
+{
+    void* span = fetchFromPageCache(size);
+    if (!span) return false;
+
+    size_t spanPages = std::max(SPAN_PAGES, PageCache::numPagesOf(size));
+    size_t totalBlocks = (spanPages * PageCache::PAGE_SIZE) / size;
+    KAMA_PROBE3(central_refill, size, span, spanPages);
+
+    // 上一个区域剩余不足一块的尾部直接舍弃
+    spanCursors_[index].cursor = static_cast<char*>(span);
+    spanCursors_[index].end = static_cast<char*>(span) + totalBlocks * size;
+    counters_[index].freeBlocks += totalBlocks;
+    return true;
+}
+
 void* CentralCache::fetchFromPageCache(size_t size)
 {   
+    KAMA_LATENCY_SCOPE(CENTRAL_FETCH_PAGE);
     // 1. 计算实际需要的页数
     size_t numPages = (size + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE;
 
@@ -150,12 +256,12 @@ void* CentralCache::fetchFromPageCache(size_t size)
     if (size <= SPAN_PAGES * PageCache::PAGE_SIZE) 
     {
         // 小于等于32KB的请求，使用固定8页
-        return PageCache::getInstance().allocateSpan(SPAN_PAGES);
+        return PageCache::forNode(node_).allocateSpan(SPAN_PAGES, size);
     } 
     else 
     {
         // 大于32KB的请求，按实际需求分配
-        return PageCache::getInstance().allocateSpan(numPages);
+        return PageCache::forNode(node_).allocateSpan(numPages, size);
     }
 }
 
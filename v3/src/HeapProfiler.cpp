@@ -0,0 +1,226 @@
+#include "../include/HeapProfiler.h"
+#include "../include/MetaAllocator.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Kama_memoryPool
+{
+
+std::atomic<size_t> HeapProfiler::sampleRate_{0};
+std::atomic<size_t> HeapProfiler::liveSamples_{0};
+std::mutex HeapProfiler::mutex_;
+HeapProfiler::Sample* HeapProfiler::table_[HeapProfiler::TABLE_SIZE];
+
+void HeapProfiler::start(size_t sampleRate)
+{
+    // 首次调用backtrace会加载libgcc_s，提前在普通上下文中完成，
+    // 避免在malloc内部第一次采样时才去加载动态库
+    void* warmup[1];
+    backtrace(warmup, 1);
+
+    sampleRate_.store(sampleRate ? sampleRate : DEFAULT_SAMPLE_RATE, std::memory_order_relaxed);
+}
+
+void HeapProfiler::stop()
+{
+    sampleRate_.store(0, std::memory_order_relaxed);
+}
+
+bool HeapProfiler::recordSample(void* ptr, size_t size, size_t sampleRate)
+{
+    // 栈回溯在加锁前完成，跳过recordSample和ThreadCache的采样函数两层
+    void* stack[MAX_DEPTH + 2];
+    int depth = backtrace(stack, MAX_DEPTH + 2);
+    int skip = std::min(depth, 2);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Sample* sample;
+    try
+    {
+        sample = MetaAllocator<Sample>().allocate(1);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+    sample->ptr = ptr;
+    sample->size = size;
+    sample->sampleRate = sampleRate;
+    sample->depth = depth - skip;
+    memcpy(sample->stack, stack + skip, sample->depth * sizeof(void*));
+
+    Sample*& head = table_[bucketOf(ptr)];
+    sample->next = head;
+    head = sample;
+    liveSamples_.fetch_add(1, std::memory_order_relaxed);
+    PageCache::markSampled(ptr);
+    return true;
+}
+
+bool HeapProfiler::removeSample(void* ptr)
+{
+    if (!PageCache::isSampledSpan(ptr)) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Sample** link = &table_[bucketOf(ptr)]; *link; link = &(*link)->next)
+    {
+        Sample* sample = *link;
+        if (sample->ptr == ptr)
+        {
+            *link = sample->next;
+            MetaAllocator<Sample>().deallocate(sample, 1);
+            liveSamples_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HeapProfiler::findSample(void* ptr)
+{
+    if (!PageCache::isSampledSpan(ptr)) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Sample* sample = table_[bucketOf(ptr)]; sample; sample = sample->next)
+    {
+        if (sample->ptr == ptr) return true;
+    }
+    return false;
+}
+
+HeapProfiler::Sample* HeapProfiler::snapshot(size_t& count)
+{
+    // 在锁外申请内存：加锁期间的内存分配可能再次进入采样路径
+    size_t capacity = liveSamples() + 64;
+    Sample* samples = static_cast<Sample*>(malloc(capacity * sizeof(Sample)));
+    count = 0;
+    if (!samples) return nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < TABLE_SIZE && count < capacity; ++i)
+    {
+        for (Sample* sample = table_[i]; sample && count < capacity; sample = sample->next)
+        {
+            samples[count++] = *sample;
+        }
+    }
+    return samples;
+}
+
+void HeapProfiler::writeHeapProfile(FILE* out)
+{
+    size_t count = 0;
+    Sample* samples = snapshot(count);
+
+    // 相同调用栈合并为一行
+    struct Bucket
+    {
+        size_t objects = 0;
+        size_t bytes = 0;
+    };
+    std::map<std::vector<void*>, Bucket> buckets;
+    size_t totalObjects = 0;
+    size_t totalBytes = 0;
+    size_t sampleRate = getSampleRate() ? getSampleRate() : DEFAULT_SAMPLE_RATE;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Bucket& bucket = buckets[std::vector<void*>(samples[i].stack, samples[i].stack + samples[i].depth)];
+        bucket.objects++;
+        bucket.bytes += samples[i].size;
+        totalObjects++;
+        totalBytes += samples[i].size;
+        sampleRate = samples[i].sampleRate;
+    }
+    free(samples);
+
+    // 记录的是原始采样值，由pprof按heap_v2/采样率还原
+    fprintf(out, "heap profile: %6zu: %8zu [%6zu: %8zu] @ heap_v2/%zu\n",
+            totalObjects, totalBytes, totalObjects, totalBytes, sampleRate);
+    for (const auto& entry : buckets)
+    {
+        fprintf(out, "%6zu: %8zu [%6zu: %8zu] @",
+                entry.second.objects, entry.second.bytes, entry.second.objects, entry.second.bytes);
+        for (void* pc : entry.first)
+        {
+            fprintf(out, " %p", pc);
+        }
+        fprintf(out, "\n");
+    }
+
+    // pprof依据映射表把地址对应到二进制文件
+    fprintf(out, "\nMAPPED_LIBRARIES:\n");
+    if (FILE* maps = fopen("/proc/self/maps", "r"))
+    {
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), maps)) > 0)
+        {
+            fwrite(buf, 1, n, out);
+        }
+        fclose(maps);
+    }
+}
+
+namespace
+{
+
+std::string symbolize(void* pc)
+{
+    Dl_info info;
+    if (dladdr(pc, &info) && info.dli_sname)
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = status == 0 ? demangled : info.dli_sname;
+        free(demangled);
+        // 分号是折叠栈的分隔符
+        std::replace(name.begin(), name.end(), ';', ':');
+        return name;
+    }
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%p", pc);
+    return buf;
+}
+
+} // namespace
+
+void HeapProfiler::writeCollapsedStacks(FILE* out)
+{
+    size_t count = 0;
+    Sample* samples = snapshot(count);
+
+    std::map<void*, std::string> symbols;
+    std::map<std::string, double> stacks;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Sample& sample = samples[i];
+        std::string line;
+        // 根调用在前
+        for (int d = sample.depth - 1; d >= 0; --d)
+        {
+            auto it = symbols.find(sample.stack[d]);
+            if (it == symbols.end())
+                it = symbols.emplace(sample.stack[d], symbolize(sample.stack[d])).first;
+            if (!line.empty()) line += ';';
+            line += it->second;
+        }
+
+        // 大小为size的对象被采样的概率为1-exp(-size/rate)，按其倒数还原
+        double scale = 1.0 / (1.0 - std::exp(-static_cast<double>(sample.size) / sample.sampleRate));
+        stacks[line] += sample.size * scale;
+    }
+    free(samples);
+
+    for (const auto& entry : stacks)
+    {
+        fprintf(out, "%s %.0f\n", entry.first.c_str(), entry.second);
+    }
+}
+
+} // namespace memoryPool
@@ -0,0 +1,102 @@
+#include "../include/LatencyHistogram.h"
+#include <thread>
+
+namespace Kama_memoryPool
+{
+
+double LatencyHistogram::cyclesPerNs()
+{
+    // 首次使用时对照steady_clock校准
+    static const double ratio = []() {
+#if defined(__x86_64__) || defined(__i386__)
+        auto begin = std::chrono::steady_clock::now();
+        uint64_t beginCycles = now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t endCycles = now();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+        return (endCycles - beginCycles) / ns;
+#else
+        return 1.0;
+#endif
+    }();
+    return ratio;
+}
+
+LatencySnapshot LatencyHistogram::snapshot(LatencyOp op)
+{
+    size_t i = static_cast<size_t>(op);
+    uint64_t counts[BUCKET_COUNT];
+    uint64_t total = 0;
+    for (size_t b = 0; b < BUCKET_COUNT; ++b)
+    {
+        counts[b] = buckets_[i][b].load(std::memory_order_relaxed);
+        total += counts[b];
+    }
+
+    LatencySnapshot result{total, 0, 0, 0, 0};
+    if (total == 0) return result;
+
+    double scale = 1.0 / cyclesPerNs();
+    // 取累计计数首次达到分位点的桶的上界
+    auto percentile = [&](double q) {
+        uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < BUCKET_COUNT; ++b)
+        {
+            seen += counts[b];
+            if (seen >= rank) return bucketUpperBound(b) * scale;
+        }
+        return bucketUpperBound(BUCKET_COUNT - 1) * scale;
+    };
+
+    result.p50 = percentile(0.50);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+    result.max = max_[i].load(std::memory_order_relaxed) * scale;
+    return result;
+}
+
+void LatencyHistogram::reset()
+{
+    for (size_t i = 0; i < OP_COUNT; ++i)
+    {
+        for (auto& bucket : buckets_[i])
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        max_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+const char* LatencyHistogram::name(LatencyOp op)
+{
+    switch (op)
+    {
+        case LatencyOp::THREAD_FETCH:         return "ThreadCache::fetchFromCentralCache";
+        case LatencyOp::THREAD_RETURN:        return "ThreadCache::returnToCentralCache";
+        case LatencyOp::CENTRAL_FETCH_RANGE:  return "CentralCache::fetchRange";
+        case LatencyOp::CENTRAL_RETURN_RANGE: return "CentralCache::returnRange";
+        case LatencyOp::CENTRAL_FETCH_PAGE:   return "CentralCache::fetchFromPageCache";
+        case LatencyOp::PAGE_ALLOCATE_SPAN:   return "PageCache::allocateSpan";
+        case LatencyOp::PAGE_DEALLOCATE_SPAN: return "PageCache::deallocateSpan";
+        case LatencyOp::PAGE_SYSTEM_ALLOC:    return "PageCache::systemAlloc";
+        default:                              return "unknown";
+    }
+}
+
+void LatencyHistogram::report(FILE* out)
+{
+    fprintf(out, "%-36s %10s %10s %10s %10s %12s\n",
+            "operation (ns)", "count", "p50", "p99", "p999", "max");
+    for (size_t i = 0; i < OP_COUNT; ++i)
+    {
+        LatencyOp op = static_cast<LatencyOp>(i);
+        LatencySnapshot s = snapshot(op);
+        if (s.count == 0) continue;
+        fprintf(out, "%-36s %10llu %10.0f %10.0f %10.0f %12.0f\n",
+                name(op), static_cast<unsigned long long>(s.count), s.p50, s.p99, s.p999, s.max);
+    }
+}
+
+} // namespace memoryPool
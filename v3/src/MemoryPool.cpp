@@ -0,0 +1,110 @@
+#include "../include/MemoryPool.h"
+#include "../include/CentralCache.h"
+#include "../include/MetaAllocator.h"
+#include "../include/ShardedHeap.h"
+
+namespace Kama_memoryPool
+{
+
+PoolStats MemoryPool::getStats()
+{
+    PoolStats stats;
+    // 先分配好空间再加锁收集，收集过程中不再申请内存
+    stats.sizeClasses.resize(FREE_LIST_SIZE);
+
+    ThreadCache::collectStats(stats);
+    CentralCache::collectStats(stats);
+    for (size_t node = 0; node < Numa::nodeCount(); ++node)
+    {
+        PageCache::forNode(node).collectStats(stats);
+    }
+
+    size_t used = 0;
+    for (size_t index = 0; index < FREE_LIST_SIZE; ++index)
+    {
+        SizeClassStats cls = stats.sizeClasses[index];
+        if (cls.allocs == 0 && cls.threadCachedBlocks == 0 && cls.centralCachedBlocks == 0)
+            continue;
+
+        cls.size = (index + 1) * ALIGNMENT;
+        stats.allocs += cls.allocs;
+        stats.frees += cls.frees;
+        stats.refills += cls.refills;
+        stats.drains += cls.drains;
+        stats.threadCacheBytes += cls.threadCachedBlocks * cls.size;
+        stats.centralCacheBytes += cls.centralCachedBlocks * cls.size;
+        stats.sizeClasses[used++] = cls;
+    }
+    stats.sizeClasses.resize(used);
+    stats.sizeClasses.shrink_to_fit();
+
+    return stats;
+}
+
+void MemoryPool::dumpStats(FILE* out)
+{
+    PoolStats stats = getStats();
+
+    fprintf(out, "------------------------------------------------\n");
+    fprintf(out, "MemoryPool stats (%zu threads)\n", stats.threads);
+    fprintf(out, "small: allocs %zu, frees %zu, hit rate %.2f%%, refills %zu, drains %zu\n",
+            stats.allocs, stats.frees, stats.hitRate() * 100, stats.refills, stats.drains);
+    fprintf(out, "large: allocs %zu, frees %zu\n", stats.largeAllocs, stats.largeFrees);
+    fprintf(out, "thread cache free:  %12zu bytes\n", stats.threadCacheBytes);
+    fprintf(out, "central cache free: %12zu bytes\n", stats.centralCacheBytes);
+    fprintf(out, "page cache free:    %12zu bytes in %zu spans\n",
+            stats.pageCacheFreeBytes, stats.pageCacheFreeSpans);
+    fprintf(out, "mapped:             %12zu bytes\n", stats.mappedBytes);
+    fprintf(out, "released:           %12zu bytes\n", stats.releasedBytes);
+
+    if (!stats.sizeClasses.empty())
+    {
+        fprintf(out, "%8s %12s %12s %8s %10s %10s %10s %10s\n",
+                "size", "allocs", "frees", "hit%", "refills", "drains", "thread", "central");
+        for (const auto& cls : stats.sizeClasses)
+        {
+            fprintf(out, "%8zu %12zu %12zu %8.2f %10zu %10zu %10zu %10zu\n",
+                    cls.size, cls.allocs, cls.frees, cls.hitRate() * 100,
+                    cls.refills, cls.drains, cls.threadCachedBlocks, cls.centralCachedBlocks);
+        }
+    }
+    fprintf(out, "------------------------------------------------\n");
+}
+
+// 加锁顺序与各层之间的嵌套一致：轨迹记录器和采样表持锁时不进入内存池，
+// 中心缓存持锁时会向页缓存申请span，页缓存和其他各层持锁时会调用元数据分配器
+void MemoryPool::prepareFork()
+{
+    TraceRecorder::lockForFork();
+    HeapProfiler::lockForFork();
+    ThreadCache::lockForFork();
+    ShardedHeap::lockForFork();
+    CentralCache::lockForFork();
+    PageCache::lockForFork();
+    MetaAllocatorLock::lock();
+}
+
+void MemoryPool::afterForkParent()
+{
+    MetaAllocatorLock::unlock();
+    PageCache::unlockAfterFork();
+    CentralCache::unlockAfterFork();
+    ShardedHeap::unlockAfterFork();
+    ThreadCache::unlockAfterFork();
+    HeapProfiler::unlockAfterFork();
+    TraceRecorder::unlockAfterForkParent();
+}
+
+void MemoryPool::afterForkChild()
+{
+    // 子进程只有调用fork的线程，直接释放prepareFork取得的锁
+    MetaAllocatorLock::unlock();
+    PageCache::unlockAfterFork();
+    CentralCache::unlockAfterFork();
+    ShardedHeap::unlockAfterFork();
+    ThreadCache::unlockAfterFork();
+    HeapProfiler::unlockAfterFork();
+    TraceRecorder::unlockAfterForkChild();
+}
+
+} // namespace memoryPool
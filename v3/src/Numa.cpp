@@ -0,0 +1,76 @@
+#include "../include/Numa.h"
+#include <cstdlib>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Kama_memoryPool
+{
+
+namespace
+{
+
+// 同<numaif.h>中的MPOL_PREFERRED，直接用系统调用，不依赖libnuma
+constexpr int MPOL_PREFERRED_MODE = 1;
+
+// 读取/sys/devices/system/node/online（如"0"、"0-1"、"0,2-3"），返回最大节点号加1；
+// 只用系统调用和栈上缓冲区，不经过malloc
+size_t onlineNodeCount()
+{
+    static const size_t count = []() -> size_t {
+        int fd = open("/sys/devices/system/node/online", O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return 1;
+        char buf[128];
+        ssize_t len = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (len <= 0) return 1;
+        buf[len] = '\0';
+
+        size_t maxNode = 0;
+        for (char* p = buf; *p;)
+        {
+            char* end;
+            size_t node = strtoul(p, &end, 10);
+            if (end == p)
+            {
+                ++p;
+                continue;
+            }
+            maxNode = std::max(maxNode, node);
+            p = end;
+        }
+        return maxNode + 1;
+    }();
+    return count;
+}
+
+} // namespace
+
+size_t Numa::detectNodeCount()
+{
+    size_t count = onlineNodeCount();
+    if (const char* env = getenv("KAMA_NUMA_NODES"))
+    {
+        count = strtoul(env, nullptr, 10);
+    }
+    return std::min(std::max(count, size_t(1)), MAX_NODES);
+}
+
+size_t Numa::queryCurrentNode()
+{
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (getcpu(&cpu, &node) != 0) return 0;
+    return node % nodeCount();
+}
+
+void Numa::bindToNode(void* addr, size_t len, size_t node)
+{
+    if (nodeCount() == 1 || node >= onlineNodeCount()) return;
+    unsigned long mask = 1UL << node;
+    // 失败（如内核未开启NUMA）时按默认策略分配，不影响正确性
+    syscall(SYS_mbind, addr, len, MPOL_PREFERRED_MODE, &mask, sizeof(mask) * 8, 0);
+}
+
+} // namespace memoryPool
@@ -1,139 +1,504 @@
 #include "PageCache.h"
+#include "LatencyHistogram.h"
+#include "Probes.h"
 #include <sys/mman.h>
-#include <cstring>
 
 namespace Kama_memoryPool
 {
 
-void* PageCache::allocateSpan(size_t numPages)
+FlatPageMap<PageCache::Span> PageCache::regionMap_;
+PageMap<PageCache::Span> PageCache::pageMap_;
+
+PageCache* PageCache::createPartitions()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    alignas(PageCache) static char storage[Numa::MAX_NODES][sizeof(PageCache)];
+    size_t nodes = Numa::nodeCount();
 
-    // 查找合适的空闲span
-    // lower_bound函数返回第一个大于等于numPages的元素的迭代器
-    auto it = freeSpans_.lower_bound(numPages);
-    if (it != freeSpans_.end())
+    // 只预留地址空间，不占用内存；提交前访问会触发段错误
+    char* base = nullptr;
+    void* mem = mmap(nullptr, REGION_BYTES, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem != MAP_FAILED)
     {
-        Span* span = it->second;
-
-        // 将取出的span从原有的空闲链表freeSpans_[it->first]中移除
-        if (span->next)
-        {
-            freeSpans_[it->first] = span->next;
-        }
+        if (regionMap_.init(pageIdOf(mem), REGION_BYTES / PAGE_SIZE))
+            base = static_cast<char*>(mem);
         else
-        {
-            freeSpans_.erase(it);
-        }
+            munmap(mem, REGION_BYTES);
+    }
+
+    size_t partitionBytes = REGION_BYTES / nodes / (COMMIT_PAGES * PAGE_SIZE) * (COMMIT_PAGES * PAGE_SIZE);
+    for (size_t node = 0; node < nodes; ++node)
+    {
+        new (storage[node]) PageCache(node, base ? base + node * partitionBytes : nullptr, partitionBytes);
+    }
+    return reinterpret_cast<PageCache*>(storage);
+}
+
+PageCache::PageCache(size_t node, char* regionBase, size_t regionBytes)
+    : node_(node)
+{
+    if (!regionBase) return;
+    regionBase_ = regionTop_ = regionCommitted_ = regionBase;
+    regionEnd_ = regionBase + regionBytes;
+    // 整段区域绑定到本节点，之后提交的页在首次访问时从本节点分配
+    Numa::bindToNode(regionBase, regionBytes, node);
+}
+
+void PageCache::lockForFork()
+{
+    for (size_t node = 0; node < Numa::nodeCount(); ++node)
+    {
+        forNode(node).mutex_.lock();
+    }
+}
+
+void PageCache::unlockAfterFork()
+{
+    for (size_t node = 0; node < Numa::nodeCount(); ++node)
+    {
+        forNode(node).mutex_.unlock();
+    }
+}
+
+void* PageCache::allocateSpan(size_t numPages, size_t objSize)
+{
+    KAMA_LATENCY_SCOPE(PAGE_ALLOCATE_SPAN);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Span* span = getSpan(numPages);
+    if (!span) return nullptr;
 
+    // 记录span信息用于回收
+    span->objSize = objSize;
+    registerSpan(span);
+    return span->pageAddr;
+}
+
+void* PageCache::allocateAlignedSpan(size_t numPages, size_t alignment, size_t objSize)
+{
+    size_t alignPages = alignment / PAGE_SIZE;
+    if (alignPages > ~size_t(0) / PAGE_SIZE - numPages) return nullptr;
+
+    KAMA_LATENCY_SCOPE(PAGE_ALLOCATE_SPAN);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t totalPages = numPages + alignPages - 1;
+    Span* span = getSpan(totalPages);
+    if (!span) return nullptr;
+
+    char* base = static_cast<char*>(span->pageAddr);
+    char* aligned = reinterpret_cast<char*>(
+        (reinterpret_cast<uintptr_t>(base) + alignment - 1) & ~(uintptr_t(alignment) - 1));
+    size_t headPages = (aligned - base) / PAGE_SIZE;
+    size_t tailPages = totalPages - headPages - numPages;
+
+    // 先登记对齐部分，头部释放时向后合并才不会越过它
+    span->pageAddr = aligned;
+    span->numPages = numPages;
+    span->objSize = objSize;
+    registerSpan(span);
+    if (tailPages) releaseSpan(newSpan(aligned + numPages * PAGE_SIZE, tailPages));
+    if (headPages) releaseSpan(newSpan(base, headPages));
+    return aligned;
+}
+
+PageCache::Span* PageCache::getSpan(size_t numPages)
+{
+    // 查找合适的空闲span
+    if (Span* span = takeFreeSpan(numPages))
+    {
         // 如果span大于需要的numPages则进行分割
         if (span->numPages > numPages) 
         {
-            Span* newSpan = new Span;
-            newSpan->pageAddr = static_cast<char*>(span->pageAddr) + 
-                                numPages * PAGE_SIZE;
-            newSpan->numPages = span->numPages - numPages;
-            newSpan->next = nullptr;
+            KAMA_PROBE3(span_split, span->pageAddr, numPages, span->numPages - numPages);
+            Span* newSpan = this->newSpan(static_cast<char*>(span->pageAddr) + 
+                                          numPages * PAGE_SIZE,
+                                          span->numPages - numPages);
 
             // 将超出部分放回空闲Span*列表头部
-            auto& list = freeSpans_[newSpan->numPages];
-            newSpan->next = list;
-            list = newSpan;
+            insertFreeSpan(newSpan);
 
             span->numPages = numPages;
         }
-
-        // 记录span信息用于回收
-        spanMap_[span->pageAddr] = span;
-        return span->pageAddr;
+        return span;
     }
 
-    // 没有合适的span，向系统申请
-    void* memory = systemAlloc(numPages);
+    // 没有合适的span，从预留区域顶部取，区域不可用或用尽时向系统申请
+    void* memory = takeRegionTop(numPages);
+    if (!memory) memory = systemAlloc(numPages);
     if (!memory) return nullptr;
+    return newSpan(memory, numPages);
+}
 
-    // 创建新的span
-    Span* span = new Span;
-    span->pageAddr = memory;
-    span->numPages = numPages;
-    span->next = nullptr;
+void* PageCache::takeRegionTop(size_t numPages)
+{
+    if (!regionBase_) return nullptr;
 
-    // 记录span信息用于回收
-    spanMap_[memory] = span;
-    return memory;
+    // 顶部已提交的页不够时继续提交，按COMMIT_PAGES取整减少系统调用
+    size_t needBytes = numPages * PAGE_SIZE;
+    size_t haveBytes = regionCommitted_ - regionTop_;
+    if (haveBytes < needBytes)
+    {
+        size_t commitBytes = (needBytes - haveBytes + COMMIT_PAGES * PAGE_SIZE - 1)
+                             / (COMMIT_PAGES * PAGE_SIZE) * (COMMIT_PAGES * PAGE_SIZE);
+        if (commitBytes > static_cast<size_t>(regionEnd_ - regionCommitted_)) return nullptr;
+        if (mprotect(regionCommitted_, commitBytes, PROT_READ | PROT_WRITE) != 0) return nullptr;
+        KAMA_PROBE2(system_alloc, regionCommitted_, commitBytes);
+        regionCommitted_ += commitBytes;
+        mappedBytes_ += commitBytes;
+    }
+
+    void* addr = regionTop_;
+    regionTop_ += needBytes;
+    return addr;
 }
 
 void PageCache::deallocateSpan(void* ptr, size_t numPages)
 {
+    size_t home = nodeOf(ptr);
+    if (home != node_)
+    {
+        forNode(home).deallocateSpan(ptr, numPages);
+        return;
+    }
+
+    KAMA_LATENCY_SCOPE(PAGE_DEALLOCATE_SPAN);
     std::lock_guard<std::mutex> lock(mutex_);
 
     // 查找对应的span，没找到代表不是PageCache分配的内存，直接返回
-    auto it = spanMap_.find(ptr);
-    if (it == spanMap_.end()) return;
+    Span* span = spanAt(pageIdOf(ptr));
+    if (!span || span->pageAddr != ptr) return;
 
-    Span* span = it->second;
+    releaseSpan(span);
+}
+
+void* PageCache::reallocateSpan(void* ptr, size_t oldPages, size_t newPages)
+{
+    size_t home = nodeOf(ptr);
+    if (home != node_) return forNode(home).reallocateSpan(ptr, oldPages, newPages);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Span* span = spanAt(pageIdOf(ptr));
+    if (!span || span->pageAddr != ptr || span->numPages != oldPages) return nullptr;
+
+    if (newPages <= oldPages)
+    {
+        // 收缩：把尾部多余的页切出来还给空闲列表
+        if (newPages < oldPages)
+        {
+            Span* tail = newSpan(static_cast<char*>(ptr) + newPages * PAGE_SIZE,
+                                 oldPages - newPages);
+            span->numPages = newPages;
+            span->objSize = newPages * PAGE_SIZE;
+            registerSpan(span);
+            releaseSpan(tail);
+        }
+        return ptr;
+    }
+
+    // 扩展：后面紧邻的span空闲且足够大时原地吞并
+    size_t needPages = newPages - oldPages;
+    void* nextAddr = static_cast<char*>(ptr) + oldPages * PAGE_SIZE;
+    Span* nextSpan = spanAt(pageIdOf(nextAddr));
+    if (nextSpan && nextSpan->pageAddr == nextAddr && nextSpan->node == node_
+        && nextSpan->numPages >= needPages && removeFreeSpan(nextSpan))
+    {
+        if (nextSpan->numPages > needPages)
+        {
+            // 剩余部分仍作为空闲span
+            nextSpan->pageAddr = static_cast<char*>(nextAddr) + needPages * PAGE_SIZE;
+            nextSpan->numPages -= needPages;
+            insertFreeSpan(nextSpan);
+        }
+        else
+        {
+            deleteSpan(nextSpan);
+        }
+
+        span->numPages = newPages;
+        span->objSize = newPages * PAGE_SIZE;
+        registerSpan(span);
+        return ptr;
+    }
+
+    // 紧邻区域顶部时直接从顶部延伸
+    if (nextAddr == regionTop_ && takeRegionTop(needPages))
+    {
+        span->numPages = newPages;
+        span->objSize = newPages * PAGE_SIZE;
+        registerSpan(span);
+        return ptr;
+    }
+
+    // 超大块用mremap由内核搬移页表，避免拷贝数据
+    if (oldPages >= REMAP_THRESHOLD_PAGES)
+    {
+        if (regionMap_.contains(pageIdOf(ptr))) return remapInRegion(span, newPages);
+
+        void* newAddr = mremap(ptr, oldPages * PAGE_SIZE, newPages * PAGE_SIZE, MREMAP_MAYMOVE);
+        if (newAddr == MAP_FAILED) return nullptr;
+        releasedBytes_ += oldPages * PAGE_SIZE;
+        KAMA_PROBE3(system_remap, ptr, newAddr, oldPages * PAGE_SIZE);
+        mappedBytes_ += newPages * PAGE_SIZE;
+
+        // 原地址范围已被内核解除映射，清除其首尾页映射，避免相邻span合并进来
+        setSpan(pageIdOf(ptr), nullptr);
+        setSpan(pageIdOf(ptr) + oldPages - 1, nullptr);
+
+        span->pageAddr = newAddr;
+        span->numPages = newPages;
+        span->objSize = newPages * PAGE_SIZE;
+        registerSpan(span);
+        return newAddr;
+    }
+
+    return nullptr;
+}
+
+void* PageCache::remapInRegion(Span* span, size_t newPages)
+{
+    Span* target = getSpan(newPages);
+    if (!target) return nullptr;
+
+    // MREMAP_FIXED先解除target原有的映射，再把旧页的页表搬过去，不拷贝数据
+    void* oldAddr = span->pageAddr;
+    size_t oldBytes = span->numPages * PAGE_SIZE;
+    void* newAddr = mremap(oldAddr, oldBytes, newPages * PAGE_SIZE,
+                           MREMAP_MAYMOVE | MREMAP_FIXED, target->pageAddr);
+    if (newAddr == MAP_FAILED)
+    {
+        releaseSpan(target);
+        return nullptr;
+    }
+    KAMA_PROBE3(system_remap, oldAddr, newAddr, oldBytes);
+
+    // 旧地址范围已被内核解除映射，重新映射为空白页，保持区域连续可用
+    bool remapped = mmap(oldAddr, oldBytes, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0) != MAP_FAILED;
+    // 新映射不继承原有的内存策略，重新绑定到本节点
+    if (remapped) Numa::bindToNode(oldAddr, oldBytes, node_);
+
+    // target改为描述旧地址范围，span描述搬移后的位置
+    target->pageAddr = oldAddr;
+    target->numPages = oldBytes / PAGE_SIZE;
+    span->pageAddr = newAddr;
+    span->numPages = newPages;
+    span->objSize = newPages * PAGE_SIZE;
+    registerSpan(span);
+    if (remapped)
+    {
+        releaseSpan(target);
+    }
+    else
+    {
+        // 重新映射失败时这段地址不再使用
+        setSpan(pageIdOf(oldAddr), nullptr);
+        setSpan(pageIdOf(oldAddr) + target->numPages - 1, nullptr);
+        deleteSpan(target);
+    }
+    return newAddr;
+}
+
+void PageCache::releaseSpan(Span* span)
+{
+    span->objSize = 0;
+    span->sampled = false;
 
     // 尝试合并相邻的span
-    void* nextAddr = static_cast<char*>(ptr) + numPages * PAGE_SIZE;
-    auto nextIt = spanMap_.find(nextAddr);
+    void* nextAddr = static_cast<char*>(span->pageAddr) + span->numPages * PAGE_SIZE;
+    Span* nextSpan = spanAt(pageIdOf(nextAddr));
     
-    if (nextIt != spanMap_.end())
-    {
-        Span* nextSpan = nextIt->second;
-        
-        // 1. 首先检查nextSpan是否在空闲链表中
-        bool found = false;
-        auto& nextList = freeSpans_[nextSpan->numPages];
-        
-        // 检查是否是头节点
-        if (nextList == nextSpan)
+    // 只有在nextSpan属于本分区且位于空闲链表中时才进行合并
+    if (nextSpan && nextSpan->pageAddr == nextAddr && nextSpan->node == node_ && removeFreeSpan(nextSpan))
+    {
+        KAMA_PROBE3(span_coalesce, span->pageAddr, span->numPages, nextSpan->numPages);
+        span->numPages += nextSpan->numPages;
+        deleteSpan(nextSpan);
+    }
+
+    // 紧邻区域顶部时并回顶部，不进入空闲列表
+    if (static_cast<char*>(span->pageAddr) + span->numPages * PAGE_SIZE == regionTop_)
+    {
+        lowerRegionTop(span);
+        // 合并只向后进行，顶部下方可能还有空闲span，一并并回顶部
+        while (regionTop_ > regionBase_)
         {
-            nextList = nextSpan->next;
-            found = true;
+            Span* prevSpan = spanAt(pageIdOf(regionTop_) - 1);
+            if (!prevSpan || prevSpan->node != node_
+                || static_cast<char*>(prevSpan->pageAddr) + prevSpan->numPages * PAGE_SIZE != regionTop_
+                || !removeFreeSpan(prevSpan))
+                break;
+            lowerRegionTop(prevSpan);
         }
-        else if (nextList) // 只有在链表非空时才遍历
+        return;
+    }
+
+    insertFreeSpan(span);
+}
+
+void PageCache::lowerRegionTop(Span* span)
+{
+    setSpan(pageIdOf(span->pageAddr), nullptr);
+    setSpan(pageIdOf(span->pageAddr) + span->numPages - 1, nullptr);
+    regionTop_ = static_cast<char*>(span->pageAddr);
+    deleteSpan(span);
+}
+
+PageCache::Span* PageCache::takeFreeSpan(size_t numPages)
+{
+    if (numPages <= NUM_BINS)
+    {
+        // 屏蔽小于numPages页的箱后取最低的置位
+        size_t bin = numPages - 1;
+        for (size_t word = bin / 64; word < NUM_BINS / 64; ++word)
         {
-            Span* prev = nextList;
-            while (prev->next)
+            uint64_t bits = binBitmap_[word];
+            if (word == bin / 64) bits &= ~uint64_t(0) << (bin % 64);
+            if (bits)
             {
-                if (prev->next == nextSpan)
-                {   
-                    // 将nextSpan从空闲链表中移除
-                    prev->next = nextSpan->next;
-                    found = true;
-                    break;
-                }
-                prev = prev->next;
+                Span* span = bins_[word * 64 + __builtin_ctzll(bits)];
+                removeFreeSpan(span);
+                return span;
             }
         }
+    }
+
+    Span key{};
+    key.numPages = numPages;
+    auto it = largeSpans_.lower_bound(&key);
+    if (it == largeSpans_.end()) return nullptr;
+    Span* span = *it;
+    largeSpans_.erase(it);
+    span->isFree = false;
+    return span;
+}
 
-        // 2. 只有在找到nextSpan的情况下才进行合并
-        if (found)
+bool PageCache::removeFreeSpan(Span* span)
+{
+    if (!span->isFree) return false;
+    span->isFree = false;
+
+    if (span->numPages > NUM_BINS)
+    {
+        largeSpans_.erase(span);
+        return true;
+    }
+
+    size_t bin = span->numPages - 1;
+    if (span->prev)
+        span->prev->next = span->next;
+    else
+        bins_[bin] = span->next;
+    if (span->next) span->next->prev = span->prev;
+
+    // 箱取空后清除位图，避免allocateSpan取到空箱
+    if (!bins_[bin]) binBitmap_[bin / 64] &= ~(uint64_t(1) << (bin % 64));
+    return true;
+}
+
+void PageCache::insertFreeSpan(Span* span)
+{
+    span->objSize = 0;
+    span->isFree = true;
+    if (span->numPages > NUM_BINS)
+    {
+        largeSpans_.insert(span);
+    }
+    else
+    {
+        // 头插法插入对应页数的箱
+        size_t bin = span->numPages - 1;
+        span->prev = nullptr;
+        span->next = bins_[bin];
+        if (span->next) span->next->prev = span;
+        bins_[bin] = span;
+        binBitmap_[bin / 64] |= uint64_t(1) << (bin % 64);
+    }
+    registerSpan(span);
+}
+
+size_t PageCache::objectSize(void* ptr)
+{
+    Span* span = spanAt(pageIdOf(ptr));
+    return span ? span->objSize : 0;
+}
+
+void PageCache::collectStats(PoolStats& stats)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Span* list : bins_)
+    {
+        for (Span* span = list; span; span = span->next)
         {
-            // 合并span
-            span->numPages += nextSpan->numPages;
-            spanMap_.erase(nextAddr);
-            delete nextSpan;
+            stats.pageCacheFreeBytes += span->numPages * PAGE_SIZE;
+            stats.pageCacheFreeSpans++;
         }
     }
+    for (Span* span : largeSpans_)
+    {
+        stats.pageCacheFreeBytes += span->numPages * PAGE_SIZE;
+        stats.pageCacheFreeSpans++;
+    }
+    if (regionCommitted_ != regionTop_)
+    {
+        // 区域顶部已提交未使用的页计为一个空闲span
+        stats.pageCacheFreeBytes += regionCommitted_ - regionTop_;
+        stats.pageCacheFreeSpans++;
+    }
+    stats.mappedBytes += mappedBytes_;
+    stats.releasedBytes += releasedBytes_;
+}
 
-    // 将合并后的span通过头插法插入空闲列表
-    auto& list = freeSpans_[span->numPages];
-    span->next = list;
-    list = span;
+PageCache::Span* PageCache::newSpan(void* pageAddr, size_t numPages)
+{
+    Span* span = MetaAllocator<Span>().allocate(1);
+    span->pageAddr = pageAddr;
+    span->numPages = numPages;
+    span->prev = nullptr;
+    span->next = nullptr;
+    span->objSize = 0;
+    span->isFree = false;
+    span->sampled = false;
+    span->node = static_cast<uint32_t>(node_);
+    return span;
+}
+
+void PageCache::deleteSpan(Span* span)
+{
+    MetaAllocator<Span>().deallocate(span, 1);
+}
+
+void PageCache::registerSpan(Span* span)
+{
+    size_t firstPage = pageIdOf(span->pageAddr);
+    if (span->objSize != 0 && span->objSize <= MAX_BYTES)
+    {
+        // 小对象span内的块可能位于任意一页
+        for (size_t i = 0; i < span->numPages; ++i) setSpan(firstPage + i, span);
+    }
+    else
+    {
+        // 空闲span和大对象span只需首尾页，供合并和释放时查找
+        setSpan(firstPage, span);
+        setSpan(firstPage + span->numPages - 1, span);
+    }
 }
 
 void* PageCache::systemAlloc(size_t numPages)
 {
+    KAMA_LATENCY_SCOPE(PAGE_SYSTEM_ALLOC);
     size_t size = numPages * PAGE_SIZE;
 
     // 使用mmap分配内存
     void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
     if (ptr == MAP_FAILED) return nullptr;
+    mappedBytes_ += size;
+    KAMA_PROBE2(system_alloc, ptr, size);
+    Numa::bindToNode(ptr, size, node_);
 
-    // 清零内存
-    memset(ptr, 0, size);
+    // 匿名映射的页由内核按需清零，这里不再访问，物理页在首次写入时才分配
     return ptr;
 }
 
@@ -0,0 +1,345 @@
+#include "../include/ShardedHeap.h"
+#include "../include/MetaAllocator.h"
+#include <mutex>
+#include <new>
+#include <pthread.h>
+
+namespace Kama_memoryPool
+{
+
+PageMap<ShardedHeap::Page> ShardedHeap::pageMap_;
+
+struct ShardedHeap::Registry
+{
+    std::mutex    mutex;
+    bool          keyCreated = false;
+    pthread_key_t key;                         // 借助线程私有数据的析构回调感知线程退出
+    Page*         abandoned[NUM_CLASSES] = {}; // 所有者已退出、仍有存活块的页，按大小类
+    Heap*         freeHeaps = nullptr;         // 线程退出后待复用的堆，堆永不释放
+    size_t        pages = 0;
+};
+
+namespace
+{
+
+// 每次从未切分区域切出的块数上限，只写入即将用到的块
+constexpr size_t CARVE_BATCH = 64;
+
+// 线程退出回调之后本线程不再登记新的堆
+thread_local bool retired = false;
+
+inline void*& nextOf(void* block)
+{
+    return *reinterpret_cast<void**>(block);
+}
+
+} // namespace
+
+// 永不析构：进程退出阶段仍可能有线程退出回调
+ShardedHeap::Registry& ShardedHeap::registry()
+{
+    alignas(Registry) static char storage[sizeof(Registry)];
+    static Registry* registry = new (storage) Registry;
+    return *registry;
+}
+
+void* ShardedHeap::allocateSlow(size_t size)
+{
+    Heap* heap = tlsHeap_ ? tlsHeap_ : initHeap();
+    size_t index = SizeClass::getIndex(size);
+    Page*& queue = heap->pages[index];
+
+    for (;;)
+    {
+        // 当前页取空：依次尝试队列中的页，仍无可用块的页移入已满链表
+        while (Page* page = queue)
+        {
+            if (refillPage(page))
+            {
+                void* block = page->freeList;
+                page->freeList = nextOf(block);
+                page->used++;
+                return block;
+            }
+            // 置位失败说明刚有其他线程释放到该页，重新收集
+            uintptr_t expected = 0;
+            if (page->threadFree.compare_exchange_strong(expected, FULL_BIT, std::memory_order_acq_rel,
+                                                         std::memory_order_relaxed))
+            {
+                unlink(queue, page);
+                page->inFull = true;
+                pushFront(heap->fullPages, page);
+            }
+        }
+
+        if (heap->pendingFull.load(std::memory_order_relaxed) != 0)
+        {
+            reclaimFullPages(heap);
+            if (queue) continue;
+        }
+        // 优先接管已退出线程留下的页，其次申请新页；两者都放到队首
+        if (!adoptPage(heap, index) && !newPage(heap, index))
+            return nullptr;
+    }
+}
+
+void ShardedHeap::localFreeSlow(Heap* heap, Page* page)
+{
+    Page*& queue = heap->pages[page->index];
+    if (page->inFull)
+    {
+        // 本线程释放到已满页：清除标记，放回页队列（排在当前页之后）
+        page->threadFree.fetch_and(~FULL_BIT, std::memory_order_relaxed);
+        unlink(heap->fullPages, page);
+        page->inFull = false;
+        if (queue)
+        {
+            page->prev = queue;
+            page->next = queue->next;
+            if (queue->next) queue->next->prev = page;
+            queue->next = page;
+        }
+        else
+        {
+            pushFront(queue, page);
+        }
+    }
+
+    // 整页空闲且不是当前页时还给页缓存
+    if (page->used == 0 && queue != page)
+    {
+        unlink(queue, page);
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        releasePage(page);
+    }
+}
+
+void ShardedHeap::remoteFree(Page* page, void* ptr)
+{
+    uintptr_t old = page->threadFree.load(std::memory_order_relaxed);
+    do
+    {
+        nextOf(ptr) = reinterpret_cast<void*>(old & ~FULL_BIT);
+    } while (!page->threadFree.compare_exchange_weak(old, reinterpret_cast<uintptr_t>(ptr),
+                                                     std::memory_order_release, std::memory_order_relaxed));
+
+    if (old & FULL_BIT)
+    {
+        // 页此前已满，通知所有者回收。此时页可能已被所有者收回甚至释放复用，
+        // 读到的所有者至多多做一次无效扫描；堆永不释放，写入总是安全的
+        if (Heap* owner = page->heap.load(std::memory_order_acquire))
+            owner->pendingFull.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void ShardedHeap::collect(Page* page)
+{
+    void* list = page->freeList;
+    if (page->localFree)
+    {
+        // localFree只由所有者写入，整链接到freeList前；分配路径上freeList已取空，不必找链尾
+        if (list)
+        {
+            void* tail = page->localFree;
+            while (nextOf(tail)) tail = nextOf(tail);
+            nextOf(tail) = list;
+        }
+        list = page->localFree;
+        page->localFree = nullptr;
+    }
+
+    uintptr_t remote = page->threadFree.exchange(0, std::memory_order_acquire) & ~FULL_BIT;
+    if (remote)
+    {
+        void* head = reinterpret_cast<void*>(remote);
+        void* tail = head;
+        size_t count = 1;
+        while (nextOf(tail))
+        {
+            tail = nextOf(tail);
+            count++;
+        }
+        nextOf(tail) = list;
+        list = head;
+        page->used -= count;
+    }
+    page->freeList = list;
+}
+
+bool ShardedHeap::refillPage(Page* page)
+{
+    if (page->freeList) return true;
+    collect(page);
+    if (page->freeList) return true;
+    if (page->cursor == page->end) return false;
+
+    size_t size = page->blockSize;
+    size_t count = std::min(CARVE_BATCH, static_cast<size_t>(page->end - page->cursor) / size);
+    char* start = page->cursor;
+    for (size_t i = 1; i < count; ++i)
+    {
+        nextOf(start + (i - 1) * size) = start + i * size;
+    }
+    nextOf(start + (count - 1) * size) = nullptr;
+    page->cursor += count * size;
+    page->freeList = start;
+    return true;
+}
+
+void ShardedHeap::reclaimFullPages(Heap* heap)
+{
+    heap->pendingFull.store(0, std::memory_order_relaxed);
+    for (Page* page = heap->fullPages; page;)
+    {
+        Page* next = page->next;
+        // 远程释放者压入时会清除FULL_BIT
+        if (!(page->threadFree.load(std::memory_order_acquire) & FULL_BIT))
+        {
+            unlink(heap->fullPages, page);
+            page->inFull = false;
+            pushFront(heap->pages[page->index], page);
+        }
+        page = next;
+    }
+}
+
+ShardedHeap::Page* ShardedHeap::newPage(Heap* heap, size_t index)
+{
+    size_t size = (index + 1) * ALIGNMENT;
+    void* start = PageCache::getInstance().allocateSpan(SPAN_PAGES, size);
+    if (!start) return nullptr;
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    Page* page = new (MetaAllocator<Page>().allocate(1)) Page{};
+    page->cursor = static_cast<char*>(start);
+    page->end = page->cursor + (SPAN_PAGES * PageCache::PAGE_SIZE) / size * size;
+    page->blockSize = size;
+    page->index = index;
+    page->heap.store(heap, std::memory_order_relaxed);
+    page->start = start;
+    pageMap_.setRange(reinterpret_cast<uintptr_t>(start) / PageCache::PAGE_SIZE, SPAN_PAGES, page);
+    reg.pages++;
+
+    pushFront(heap->pages[index], page);
+    return page;
+}
+
+ShardedHeap::Page* ShardedHeap::adoptPage(Heap* heap, size_t index)
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    Page* page = reg.abandoned[index];
+    if (!page) return nullptr;
+
+    unlink(reg.abandoned[index], page);
+    page->heap.store(heap, std::memory_order_release);
+    pushFront(heap->pages[index], page);
+    return page;
+}
+
+void ShardedHeap::releasePage(Page* page)
+{
+    pageMap_.setRange(reinterpret_cast<uintptr_t>(page->start) / PageCache::PAGE_SIZE, SPAN_PAGES, nullptr);
+    PageCache::getInstance().deallocateSpan(page->start, SPAN_PAGES);
+    MetaAllocator<Page>().deallocate(page, 1);
+    registry().pages--;
+}
+
+ShardedHeap::Heap* ShardedHeap::initHeap()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    Heap* heap = reg.freeHeaps;
+    if (heap)
+        reg.freeHeaps = heap->nextFree;
+    else
+        heap = MetaAllocator<Heap>().allocate(1);
+    new (heap) Heap{};
+
+    // 线程退出回调中再次分配时不再登记，这个堆随线程一起遗留
+    if (!retired)
+    {
+        if (!reg.keyCreated)
+        {
+            pthread_key_create(&reg.key, &ShardedHeap::onThreadExit);
+            reg.keyCreated = true;
+        }
+        pthread_setspecific(reg.key, heap);
+    }
+    tlsHeap_ = heap;
+    return heap;
+}
+
+void ShardedHeap::onThreadExit(void* arg)
+{
+    Heap* heap = static_cast<Heap*>(arg);
+    tlsHeap_ = nullptr;
+    retired = true;
+
+    // 所有页收集后，整页空闲的还给页缓存，其余交给以后需要该大小类的线程接管
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto abandon = [&](Page* page) {
+        collect(page);
+        page->inFull = false;
+        if (page->used == 0)
+        {
+            releasePage(page);
+            return;
+        }
+        page->heap.store(nullptr, std::memory_order_release);
+        pushFront(reg.abandoned[page->index], page);
+    };
+    for (size_t index = 0; index < NUM_CLASSES; ++index)
+    {
+        while (Page* page = heap->pages[index])
+        {
+            unlink(heap->pages[index], page);
+            abandon(page);
+        }
+    }
+    while (Page* page = heap->fullPages)
+    {
+        unlink(heap->fullPages, page);
+        abandon(page);
+    }
+
+    heap->nextFree = reg.freeHeaps;
+    reg.freeHeaps = heap;
+}
+
+void ShardedHeap::lockForFork()
+{
+    registry().mutex.lock();
+}
+
+void ShardedHeap::unlockAfterFork()
+{
+    registry().mutex.unlock();
+}
+
+size_t ShardedHeap::pageCount()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return reg.pages;
+}
+
+void ShardedHeap::pushFront(Page*& list, Page* page)
+{
+    page->prev = nullptr;
+    page->next = list;
+    if (list) list->prev = page;
+    list = page;
+}
+
+void ShardedHeap::unlink(Page*& list, Page* page)
+{
+    if (page->prev) page->prev->next = page->next;
+    else list = page->next;
+    if (page->next) page->next->prev = page->prev;
+    page->prev = page->next = nullptr;
+}
+
+} // namespace memoryPool
@@ -1,24 +1,100 @@
 #include "../include/ThreadCache.h"
 #include "../include/CentralCache.h"
+#include "../include/PageCache.h"
+#include "../include/LatencyHistogram.h"
+#include "../include/Probes.h"
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <pthread.h>
 
 namespace Kama_memoryPool
 {
 
-void* ThreadCache::allocate(size_t size)
+namespace
+{
+
+// 线程缓存登记表
+struct ThreadRegistry
+{
+    std::mutex   mutex;
+    ThreadCache* head = nullptr;
+    bool         keyCreated = false;
+    pthread_key_t key;   // 借助线程私有数据的析构回调感知线程退出
+    // 已退出线程的计数
+    size_t retiredLargeAllocs = 0;
+    size_t retiredLargeFrees = 0;
+};
+
+// 已退出线程各大小类的分配次数，受ThreadRegistry::mutex保护
+std::array<size_t, FREE_LIST_SIZE> retiredAllocs;
+
+// 永不析构：进程退出阶段仍可能有线程退出回调
+ThreadRegistry& threadRegistry()
+{
+    alignas(ThreadRegistry) static char storage[sizeof(ThreadRegistry)];
+    static ThreadRegistry* registry = new (storage) ThreadRegistry;
+    return *registry;
+}
+
+// 统计读取与所属线程的写入并发，只要求读到某个近期的值
+inline size_t loadRelaxed(const size_t& value)
+{
+    return __atomic_load_n(&value, __ATOMIC_RELAXED);
+}
+
+} // namespace
+
+__attribute__((noinline)) void* ThreadCache::allocateSlow(size_t size)
 {
     // 处理0大小的分配请求
     if (size == 0)
     {
         size = ALIGNMENT; // 至少分配一个对齐大小
     }
-    
+
+    void* ptr;
+    if (size >= bytesUntilSample_)
+    {
+        ptr = sampleAllocation(size);
+    }
+    else
+    {
+        bytesUntilSample_ -= size;
+        ptr = allocateFromCache(size);
+    }
+
+    if (ptr && TraceRecorder::enabled())
+    {
+        TraceRecorder::record(TraceOp::ALLOC, size, ptr);
+    }
+    return ptr;
+}
+
+void* ThreadCache::allocatePageAligned(size_t size, size_t alignment)
+{
+    largeAllocCount_++;
+    void* ptr = PageCache::getInstance().allocateAlignedSpan(PageCache::numPagesOf(size), alignment, size);
+    if (ptr && TraceRecorder::enabled())
+    {
+        TraceRecorder::record(TraceOp::ALLOC, size, ptr);
+    }
+    return ptr;
+}
+
+void* ThreadCache::allocateFromCache(size_t size)
+{
     if (size > MAX_BYTES)
     {
-        // 大对象直接从系统分配
-        return malloc(size);
+        // 大对象直接从页缓存分配整页span，起始地址天然页对齐
+        size_t numPages = PageCache::numPagesOf(size);
+        largeAllocCount_++;
+        return PageCache::getInstance().allocateSpan(numPages, numPages * PageCache::PAGE_SIZE);
     }
 
     size_t index = SizeClass::getIndex(size);
+    allocCount_[index]++;
 
     // 更新自由链表大小
     freeListSize_[index]--;
@@ -35,11 +111,23 @@ void* ThreadCache::allocate(size_t size)
     return fetchFromCentralCache(index);
 }
 
-void ThreadCache::deallocate(void* ptr, size_t size)
+__attribute__((noinline)) void ThreadCache::deallocateSlow(void* ptr, size_t size)
 {
+    if (TraceRecorder::enabled())
+    {
+        TraceRecorder::record(TraceOp::FREE, size, ptr);
+    }
+
+    if (HeapProfiler::removeIfSampled(ptr))
+    {
+        freeSampled(ptr, size);
+        return;
+    }
+
     if (size > MAX_BYTES)
     {
-        free(ptr);
+        largeFreeCount_++;
+        PageCache::getInstance().deallocateSpan(ptr, PageCache::numPagesOf(size));
         return;
     }
 
@@ -59,43 +147,166 @@ void ThreadCache::deallocate(void* ptr, size_t size)
     }
 }
 
-// 判断是否需要将内存回收给中心缓存
-bool ThreadCache::shouldReturnToCentralCache(size_t index)
+void* ThreadCache::reallocate(void* ptr, size_t oldSize, size_t newSize)
+{
+    if (!ptr) return allocate(newSize);
+
+    // 采样对象总是重新分配，避免地址变化后采样表中留下失效记录
+    if (!HeapProfiler::isSampled(ptr))
+    {
+        if (oldSize <= MAX_BYTES && newSize <= MAX_BYTES)
+        {
+            // 仍落在同一大小类，直接返回原指针
+            if (SizeClass::getIndex(oldSize) == SizeClass::getIndex(newSize))
+                return ptr;
+        }
+        else if (oldSize > MAX_BYTES && newSize > MAX_BYTES)
+        {
+            // 大对象尝试在页缓存中原地伸缩或mremap
+            void* result = PageCache::getInstance().reallocateSpan(
+                ptr, PageCache::numPagesOf(oldSize), PageCache::numPagesOf(newSize));
+            if (result)
+            {
+                if (TraceRecorder::enabled())
+                {
+                    TraceRecorder::record(TraceOp::FREE, oldSize, ptr);
+                    TraceRecorder::record(TraceOp::ALLOC, newSize, result);
+                }
+                return result;
+            }
+        }
+    }
+
+    // 无法原地完成：分配新块并拷贝
+    void* newPtr = allocate(newSize);
+    if (!newPtr) return nullptr;
+    memcpy(newPtr, ptr, std::min(oldSize, newSize));
+    deallocate(ptr, oldSize);
+    return newPtr;
+}
+
+size_t ThreadCache::allocateBatch(size_t size, void** out, size_t n)
 {
-    // 设定阈值，例如：当自由链表的大小超过一定数量时
-    size_t threshold = 64; // 例如，64个内存块
-    return (freeListSize_[index] > threshold);
+    if (size == 0)
+    {
+        size = ALIGNMENT;
+    }
+
+    if (size > MAX_BYTES)
+    {
+        // 大对象没有自由链表，逐个分配
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (!(out[i] = allocate(size))) return i;
+        }
+        return n;
+    }
+
+    size_t index = SizeClass::getIndex(size);
+    size_t count = 0;
+
+    // 先从线程本地自由链表整段取出
+    void* ptr = freeList_[index];
+    while (ptr && count < n)
+    {
+        out[count++] = ptr;
+        ptr = *reinterpret_cast<void**>(ptr);
+    }
+    freeList_[index] = ptr;
+    freeListSize_[index] -= count;
+
+    // 不足的部分按实际缺少的数量向中心缓存一次性获取
+    if (count < n) registerThread();
+    while (count < n)
+    {
+        size_t fetchedNum = 0;
+        void* start = CentralCache::getInstance().fetchRange(index, n - count, fetchedNum);
+        if (!start) break;
+
+        for (void* cur = start; cur; cur = *reinterpret_cast<void**>(cur))
+        {
+            out[count++] = cur;
+        }
+    }
+
+    allocCount_[index] += count;
+
+    if (TraceRecorder::enabled())
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            TraceRecorder::record(TraceOp::ALLOC, size, out[i]);
+        }
+    }
+    return count;
+}
+
+void ThreadCache::deallocateBatch(size_t size, void** ptrs, size_t n)
+{
+    if (n == 0) return;
+
+    // 有未释放的采样对象或正在记录轨迹时逐个释放
+    if (size > MAX_BYTES || HeapProfiler::liveSamples() != 0 || TraceRecorder::enabled())
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            deallocate(ptrs[i], size);
+        }
+        return;
+    }
+
+    size_t index = SizeClass::getIndex(size);
+
+    // 先把这批内存块串成链表，再整体插入线程本地自由链表头部
+    for (size_t i = 0; i + 1 < n; ++i)
+    {
+        *reinterpret_cast<void**>(ptrs[i]) = ptrs[i + 1];
+    }
+    *reinterpret_cast<void**>(ptrs[n - 1]) = freeList_[index];
+    freeList_[index] = ptrs[0];
+    freeListSize_[index] += n;
+
+    if (shouldReturnToCentralCache(index))
+    {
+        returnToCentralCache(freeList_[index], size);
+    }
 }
 
 void* ThreadCache::fetchFromCentralCache(size_t index)
 {
+    KAMA_LATENCY_SCOPE(THREAD_FETCH);
     size_t size = (index + 1) * ALIGNMENT;
     // 根据对象内存大小计算批量获取的数量
     size_t batchNum = getBatchNum(size);
+    KAMA_PROBE2(thread_cache_miss, size, batchNum);
     // 从中心缓存批量获取内存
-    void* start = CentralCache::getInstance().fetchRange(index, batchNum);
-    if (!start) return nullptr;
+    size_t fetchedNum = 0;
+    registerThread();
+    void* start = CentralCache::getInstance().fetchRange(index, batchNum, fetchedNum);
+    if (!start)
+    {
+        // 分配失败，撤销allocate中预先减掉的计数
+        freeListSize_[index]++;
+        allocCount_[index]--;
+        return nullptr;
+    }
 
-    // 更新自由链表大小
-    freeListSize_[index] += batchNum; // 增加对应大小类的自由链表大小
+    // 更新自由链表大小（按实际取到的数量）
+    freeListSize_[index] += fetchedNum; // 增加对应大小类的自由链表大小
 
     // 取一个返回，其余放入线程本地自由链表
     void* result = start;
-    if (batchNum > 1)
-    {
-        freeList_[index] = *reinterpret_cast<void**>(start);
-    }
+    freeList_[index] = *reinterpret_cast<void**>(start);
     
     return result;
 }
 
 void ThreadCache::returnToCentralCache(void* start, size_t size)
 {
+    KAMA_LATENCY_SCOPE(THREAD_RETURN);
     // 根据大小计算对应的索引
     size_t index = SizeClass::getIndex(size);
-
-    // 获取对齐后的实际块大小
-    size_t alignedSize = SizeClass::roundUp(size);
+    registerThread();
 
     // 计算要归还内存块数量
     size_t batchNum = freeListSize_[index];
@@ -135,8 +346,164 @@ void ThreadCache::returnToCentralCache(void* start, size_t size)
         // 将剩余部分返回给CentralCache
         if (returnNum > 0 && nextNode != nullptr)
         {
-            CentralCache::getInstance().returnRange(nextNode, returnNum * alignedSize, index);
+            KAMA_PROBE2(thread_cache_return, size, returnNum);
+            CentralCache::getInstance().returnRange(nextNode, returnNum, index);
+        }
+    }
+}
+
+__attribute__((noinline)) void* ThreadCache::sampleAllocation(size_t size)
+{
+    size_t sampleRate = HeapProfiler::getSampleRate();
+    // 未开启时也按默认间隔倒计时，开启后各线程最多在一个间隔内生效
+    bytesUntilSample_ = nextSampleInterval(sampleRate ? sampleRate : HeapProfiler::DEFAULT_SAMPLE_RATE);
+    if (sampleRate == 0 || inSample_)
+    {
+        return allocateFromCache(size);
+    }
+
+    inSample_ = true;
+    void* ptr;
+    if (size > MAX_BYTES)
+    {
+        ptr = allocateFromCache(size);
+    }
+    else
+    {
+        // 小对象单独占用页对齐的span，释放时只有页对齐地址才需要查采样表
+        size_t objSize = SizeClass::roundUp(size);
+        ptr = PageCache::getInstance().allocateSpan(PageCache::numPagesOf(objSize), objSize);
+    }
+
+    if (ptr && !HeapProfiler::recordSample(ptr, size, sampleRate) && size <= MAX_BYTES)
+    {
+        PageCache::getInstance().deallocateSpan(ptr, PageCache::numPagesOf(size));
+        ptr = allocateFromCache(size);
+    }
+    inSample_ = false;
+    return ptr;
+}
+
+void ThreadCache::freeSampled(void* ptr, size_t size)
+{
+    if (size > MAX_BYTES) largeFreeCount_++;
+    PageCache::getInstance().deallocateSpan(ptr, PageCache::numPagesOf(size));
+}
+
+size_t ThreadCache::nextSampleInterval(size_t sampleRate)
+{
+    // xorshift64*，首次使用时以线程缓存地址作种子
+    if (sampleRandom_ == 0)
+    {
+        sampleRandom_ = reinterpret_cast<uintptr_t>(this) | 1;
+    }
+    sampleRandom_ ^= sampleRandom_ >> 12;
+    sampleRandom_ ^= sampleRandom_ << 25;
+    sampleRandom_ ^= sampleRandom_ >> 27;
+    uint64_t random = sampleRandom_ * 0x2545F4914F6CDD1DULL;
+
+    // 取53位均匀分布 u∈[0,1)，间隔 = -ln(1-u) * sampleRate
+    double u = static_cast<double>(random >> 11) * (1.0 / 9007199254740992.0);
+    double interval = -std::log(1.0 - u) * static_cast<double>(sampleRate);
+    return static_cast<size_t>(std::min(std::max(interval, 1.0), 50.0 * sampleRate));
+}
+
+void ThreadCache::lockForFork()
+{
+    threadRegistry().mutex.lock();
+}
+
+void ThreadCache::unlockAfterFork()
+{
+    threadRegistry().mutex.unlock();
+}
+
+void ThreadCache::registerThreadSlow()
+{
+    // 线程退出回调中释放内存时不再重新登记，此时线程本地存储即将失效
+    if (retired_) return;
+
+    ThreadRegistry& registry = threadRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (!registry.keyCreated)
+    {
+        pthread_key_create(&registry.key, &ThreadCache::onThreadExit);
+        registry.keyCreated = true;
+    }
+    pthread_setspecific(registry.key, this);
+
+    prev_ = nullptr;
+    next_ = registry.head;
+    if (registry.head) registry.head->prev_ = this;
+    registry.head = this;
+    registered_ = true;
+}
+
+void ThreadCache::onThreadExit(void* cache)
+{
+    ThreadCache* self = static_cast<ThreadCache*>(cache);
+
+    // 线程缓存中的空闲块全部还给中心缓存，避免随线程一起泄漏
+    for (size_t index = 0; index < FREE_LIST_SIZE; ++index)
+    {
+        void* start = self->freeList_[index];
+        if (!start) continue;
+
+        size_t count = 0;
+        for (void* cur = start; cur; cur = *reinterpret_cast<void**>(cur))
+        {
+            count++;
+        }
+        self->freeList_[index] = nullptr;
+        self->freeListSize_[index] = 0;
+        CentralCache::getInstance().returnRange(start, count, index);
+    }
+
+    ThreadRegistry& registry = threadRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (size_t index = 0; index < FREE_LIST_SIZE; ++index)
+    {
+        retiredAllocs[index] += self->allocCount_[index];
+        self->allocCount_[index] = 0;
+    }
+    registry.retiredLargeAllocs += self->largeAllocCount_;
+    registry.retiredLargeFrees += self->largeFreeCount_;
+    self->largeAllocCount_ = 0;
+    self->largeFreeCount_ = 0;
+
+    if (self->prev_) self->prev_->next_ = self->next_;
+    else registry.head = self->next_;
+    if (self->next_) self->next_->prev_ = self->prev_;
+    self->registered_ = false;
+    self->retired_ = true;
+}
+
+void ThreadCache::collectStats(PoolStats& stats)
+{
+    ThreadRegistry& registry = threadRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (size_t index = 0; index < FREE_LIST_SIZE; ++index)
+    {
+        stats.sizeClasses[index].allocs += retiredAllocs[index];
+    }
+    stats.largeAllocs += registry.retiredLargeAllocs;
+    stats.largeFrees += registry.retiredLargeFrees;
+
+    for (ThreadCache* cache = registry.head; cache; cache = cache->next_)
+    {
+        for (size_t index = 0; index < FREE_LIST_SIZE; ++index)
+        {
+            SizeClassStats& cls = stats.sizeClasses[index];
+            cls.allocs += loadRelaxed(cache->allocCount_[index]);
+            // 分配时先减后取，可能短暂为“负数”
+            size_t cachedNum = loadRelaxed(cache->freeListSize_[index]);
+            if (static_cast<ptrdiff_t>(cachedNum) > 0)
+                cls.threadCachedBlocks += cachedNum;
         }
+        stats.largeAllocs += loadRelaxed(cache->largeAllocCount_);
+        stats.largeFrees += loadRelaxed(cache->largeFreeCount_);
+        stats.threads++;
     }
 }
 
@@ -160,7 +527,7 @@ size_t ThreadCache::getBatchNum(size_t size)
     size_t maxNum = std::max(size_t(1), MAX_BATCH_SIZE / size);
 
     // 取最小值，但确保至少返回1
-    return std::max(sizeof(1), std::min(maxNum, baseNum));
+    return std::max(size_t(1), std::min(maxNum, baseNum));
 }
 
 } // namespace memoryPool
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "../include/TraceRecorder.h"
+#include "../include/LatencyHistogram.h"
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Kama_memoryPool
+{
+
+namespace
+{
+
+const size_t BUFFER_RECORDS = 16 * 1024; // 每线程缓冲384KB
+
+struct ThreadBuffer
+{
+    std::atomic_flag lock;
+    uint64_t         generation; // 所属的记录批次，批次不符说明已被stop回收
+    uint16_t         thread;
+    size_t           count;
+    ThreadBuffer*    next;
+    TraceRecord      records[BUFFER_RECORDS];
+};
+
+// 缓冲区直接mmap并在停止后复用，记录过程中不调用malloc
+struct Recorder
+{
+    std::mutex    mutex;          // 保护文件写入和缓冲区链表
+    int           fd = -1;
+    ThreadBuffer* active = nullptr;
+    ThreadBuffer* spare = nullptr;
+    uint16_t      nextThread = 0;
+    std::atomic<uint64_t> generation{0};
+};
+
+Recorder& recorder()
+{
+    alignas(Recorder) static char storage[sizeof(Recorder)];
+    static Recorder* instance = new (storage) Recorder;
+    return *instance;
+}
+
+thread_local ThreadBuffer* tlsBuffer = nullptr;
+thread_local uint64_t      tlsGeneration = 0;
+
+void writeAll(int fd, const void* data, size_t bytes)
+{
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0)
+    {
+        ssize_t n = ::write(fd, p, bytes);
+        if (n <= 0) return;
+        p += n;
+        bytes -= n;
+    }
+}
+
+// 调用方持有缓冲区的锁
+void flush(ThreadBuffer* buffer)
+{
+    Recorder& r = recorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.fd >= 0) writeAll(r.fd, buffer->records, buffer->count * sizeof(TraceRecord));
+    buffer->count = 0;
+}
+
+ThreadBuffer* acquireBuffer(uint64_t generation)
+{
+    Recorder& r = recorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    // stop先清除开关再回收缓冲区，这里在锁内复查可避免回收后又挂上新的缓冲区
+    if (!TraceRecorder::enabled() || r.generation.load(std::memory_order_relaxed) != generation)
+        return nullptr;
+
+    ThreadBuffer* buffer = r.spare;
+    if (buffer)
+    {
+        r.spare = buffer->next;
+    }
+    else
+    {
+        void* mem = mmap(nullptr, sizeof(ThreadBuffer), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) return nullptr;
+        buffer = static_cast<ThreadBuffer*>(mem);
+        buffer->lock.clear();
+    }
+
+    buffer->generation = generation;
+    buffer->thread = r.nextThread++;
+    buffer->count = 0;
+    buffer->next = r.active;
+    r.active = buffer;
+    return buffer;
+}
+
+} // namespace
+
+bool TraceRecorder::start(const char* path)
+{
+    Recorder& r = recorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (enabled()) return false;
+
+    r.fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (r.fd < 0) return false;
+
+    TraceHeader header;
+    memcpy(header.magic, "KAMATRC1", sizeof(header.magic));
+    header.recordSize = sizeof(TraceRecord);
+    header.reserved = 0;
+    writeAll(r.fd, &header, sizeof(header));
+
+    r.nextThread = 0;
+    r.generation.fetch_add(1, std::memory_order_release);
+    enabled_.store(true, std::memory_order_release);
+    return true;
+}
+
+void TraceRecorder::stop()
+{
+    Recorder& r = recorder();
+    ThreadBuffer* buffers;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (!enabled()) return;
+        enabled_.store(false, std::memory_order_release);
+        buffers = r.active;
+        r.active = nullptr;
+    }
+
+    // 逐个写出剩余记录；持锁顺序与record一致（先缓冲区后互斥锁）
+    ThreadBuffer* last = nullptr;
+    for (ThreadBuffer* buffer = buffers; buffer; buffer = buffer->next)
+    {
+        while (buffer->lock.test_and_set(std::memory_order_acquire))
+        {
+        }
+        flush(buffer);
+        buffer->generation = 0;
+        buffer->lock.clear(std::memory_order_release);
+        last = buffer;
+    }
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (last)
+    {
+        last->next = r.spare;
+        r.spare = buffers;
+    }
+    ::close(r.fd);
+    r.fd = -1;
+}
+
+void TraceRecorder::lockForFork()
+{
+    recorder().mutex.lock();
+}
+
+void TraceRecorder::unlockAfterForkParent()
+{
+    recorder().mutex.unlock();
+}
+
+void TraceRecorder::unlockAfterForkChild()
+{
+    Recorder& r = recorder();
+    if (enabled())
+    {
+        // 其他线程的缓冲区可能在fork时正被持有，子进程中只剩当前线程，直接重置
+        enabled_.store(false, std::memory_order_release);
+        ThreadBuffer* last = nullptr;
+        for (ThreadBuffer* buffer = r.active; buffer; buffer = buffer->next)
+        {
+            buffer->lock.clear(std::memory_order_relaxed);
+            buffer->generation = 0;
+            buffer->count = 0;
+            last = buffer;
+        }
+        if (last)
+        {
+            last->next = r.spare;
+            r.spare = r.active;
+        }
+        r.active = nullptr;
+        ::close(r.fd);
+        r.fd = -1;
+    }
+    r.mutex.unlock();
+}
+
+void TraceRecorder::record(TraceOp op, size_t size, void* ptr)
+{
+    uint64_t timestamp = LatencyHistogram::now();
+    uint64_t generation = recorder().generation.load(std::memory_order_acquire);
+
+    ThreadBuffer* buffer = tlsBuffer;
+    if (!buffer || tlsGeneration != generation)
+    {
+        buffer = acquireBuffer(generation);
+        if (!buffer) return;
+        tlsBuffer = buffer;
+        tlsGeneration = generation;
+    }
+
+    while (buffer->lock.test_and_set(std::memory_order_acquire))
+    {
+    }
+    if (buffer->generation == generation)
+    {
+        TraceRecord& rec = buffer->records[buffer->count++];
+        rec.timestamp = timestamp;
+        rec.ptr = reinterpret_cast<uintptr_t>(ptr);
+        rec.size = static_cast<uint32_t>(size < UINT32_MAX ? size : UINT32_MAX);
+        rec.thread = buffer->thread;
+        rec.op = static_cast<uint8_t>(op);
+        rec.reserved = 0;
+        if (buffer->count == BUFFER_RECORDS) flush(buffer);
+    }
+    buffer->lock.clear(std::memory_order_release);
+}
+
+} // namespace memoryPool
@@ -0,0 +1,318 @@
+#pragma once
+// 基准测试工具：重复运行、丢弃预热、中位数/MAD统计、CPU绑定、JSON输出。
+// 每个场景默认在独立子进程中运行，避免不同分配器/场景之间的预热与顺序互相影响
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace bench
+{
+
+struct Options
+{
+    int         repetitions = 15; // 计入统计的轮数
+    int         warmup = 3;       // 丢弃的预热轮数
+    int         cpu = -1;         // 主线程绑定的CPU，-1表示不绑定
+    bool        fork = true;      // 每个场景在独立子进程中运行
+    int         processes = 1;    // 测量轮分摊到几个子进程，使样本包含进程间的差异（内存布局等）
+    std::string filter;           // 只运行名字包含该子串的场景
+    std::string jsonPath;         // 非空时把结果写成JSON
+};
+
+inline void printUsage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [--reps N] [--warmup N] [--cpu N] [--processes N] [--no-fork] [--filter STR] [--json FILE]\n",
+            prog);
+}
+
+// 解析命令行，出错时返回false
+inline bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--reps" && hasValue) options.repetitions = std::max(1, atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue) options.warmup = std::max(0, atoi(argv[++i]));
+        else if (arg == "--cpu" && hasValue) options.cpu = atoi(argv[++i]);
+        else if (arg == "--filter" && hasValue) options.filter = argv[++i];
+        else if (arg == "--json" && hasValue) options.jsonPath = argv[++i];
+        else if (arg == "--processes" && hasValue) options.processes = std::max(1, atoi(argv[++i]));
+        else if (arg == "--no-fork") options.fork = false;
+        else
+        {
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// 程序名（去掉路径），用于区分同一源码编译出的不同版本
+inline const char* programName(const char* argv0)
+{
+    const char* slash = strrchr(argv0, '/');
+    return slash ? slash + 1 : argv0;
+}
+
+inline uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline int cpuCount()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? static_cast<int>(n) : 1;
+}
+
+// 把当前线程绑定到cpu（按CPU数取模），cpu<0时不做任何事
+inline void pinThread(int cpu)
+{
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % cpuCount(), &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+// 阻止编译器把结果优化掉
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// 启动n个线程同时执行body(i)，返回从放行到全部结束的纳秒数。
+// baseCpu>=0时第i个线程绑定到baseCpu+i
+inline uint64_t runThreads(size_t n, const std::function<void(size_t)>& body, int baseCpu = -1)
+{
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            pinThread(baseCpu < 0 ? -1 : baseCpu + static_cast<int>(i));
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            body(i);
+        });
+    }
+    while (ready.load() < n) std::this_thread::yield();
+
+    uint64_t start = nowNs();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    return nowNs() - start;
+}
+
+inline double median(std::vector<double> values)
+{
+    if (values.empty()) return 0;
+    size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    double upper = values[mid];
+    if (values.size() % 2) return upper;
+    return (*std::max_element(values.begin(), values.begin() + mid) + upper) / 2;
+}
+
+// 中位数绝对偏差
+inline double mad(const std::vector<double>& values)
+{
+    double m = median(values);
+    std::vector<double> deviations;
+    for (double v : values)
+    {
+        deviations.push_back(std::fabs(v - m));
+    }
+    return median(deviations);
+}
+
+// 在子进程中执行fn并通过管道取回结果，子进程异常退出时返回false
+inline bool runInChild(const std::function<std::vector<double>()>& fn, std::vector<double>& result)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    fflush(stdout);
+
+    pid_t pid = ::fork();
+    if (pid < 0) return false;
+    if (pid == 0)
+    {
+        close(fds[0]);
+        std::vector<double> values = fn();
+        size_t n = values.size();
+        bool ok = write(fds[1], &n, sizeof(n)) == sizeof(n)
+               && write(fds[1], values.data(), n * sizeof(double)) == static_cast<ssize_t>(n * sizeof(double));
+        _exit(ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    size_t n = 0;
+    bool ok = read(fds[0], &n, sizeof(n)) == sizeof(n);
+    if (ok)
+    {
+        result.resize(n);
+        size_t got = 0;
+        while (got < n * sizeof(double))
+        {
+            ssize_t r = read(fds[0], reinterpret_cast<char*>(result.data()) + got, n * sizeof(double) - got);
+            if (r <= 0) break;
+            got += r;
+        }
+        ok = got == n * sizeof(double);
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+struct Result
+{
+    std::string         name;
+    size_t              ops;
+    std::vector<double> samples; // 每轮的 ns/op
+    double              medianNs;
+    double              madNs;
+    double              minNs;
+};
+
+// 执行一轮场景，返回计时部分耗时的纳秒数；准备和清理工作可放在计时之外
+using RunFn = std::function<uint64_t()>;
+
+class Suite
+{
+public:
+    explicit Suite(const Options& options) : options_(options) {}
+
+    // opsPerRun为每轮的操作数，用于换算 ns/op
+    void add(const std::string& name, size_t opsPerRun, RunFn fn)
+    {
+        cases_.push_back({name, opsPerRun, std::move(fn)});
+    }
+
+    // 运行所有场景并输出，返回进程退出码
+    int run()
+    {
+        printf("%-40s %12s %10s %12s %6s\n", "benchmark", "median ns/op", "MAD %", "min ns/op", "reps");
+        std::vector<Result> results;
+        int failures = 0;
+        for (const Case& c : cases_)
+        {
+            if (!options_.filter.empty() && c.name.find(options_.filter) == std::string::npos)
+                continue;
+
+            std::vector<double> samples;
+            if (!(options_.fork ? runForked(c, samples) : (samples = runCase(c, options_.repetitions), true)))
+            {
+                printf("%-40s failed\n", c.name.c_str());
+                failures++;
+                continue;
+            }
+
+            Result r{c.name, c.ops, samples, median(samples), mad(samples),
+                     *std::min_element(samples.begin(), samples.end())};
+            printf("%-40s %12.2f %9.1f%% %12.2f %6zu\n", r.name.c_str(), r.medianNs,
+                   r.medianNs > 0 ? r.madNs / r.medianNs * 100 : 0.0, r.minNs, r.samples.size());
+            fflush(stdout);
+            results.push_back(std::move(r));
+        }
+
+        if (!options_.jsonPath.empty() && !writeJson(results))
+        {
+            fprintf(stderr, "cannot write %s\n", options_.jsonPath.c_str());
+            return 1;
+        }
+        // 仍写出成功场景的结果，但崩溃的场景使整体失败
+        if (failures)
+        {
+            fprintf(stderr, "%d benchmark(s) failed\n", failures);
+            return 1;
+        }
+        return 0;
+    }
+
+private:
+    struct Case
+    {
+        std::string name;
+        size_t      ops;
+        RunFn       fn;
+    };
+
+    // 每个子进程各自预热后测量一部分轮次
+    bool runForked(const Case& c, std::vector<double>& samples)
+    {
+        int processes = std::min(options_.processes, options_.repetitions);
+        for (int p = 0; p < processes; ++p)
+        {
+            int reps = options_.repetitions / processes + (p < options_.repetitions % processes ? 1 : 0);
+            std::vector<double> part;
+            if (!runInChild([this, &c, reps]() { return runCase(c, reps); }, part)) return false;
+            samples.insert(samples.end(), part.begin(), part.end());
+        }
+        return true;
+    }
+
+    std::vector<double> runCase(const Case& c, int repetitions)
+    {
+        pinThread(options_.cpu);
+        for (int i = 0; i < options_.warmup; ++i)
+        {
+            c.fn();
+        }
+        std::vector<double> samples;
+        for (int i = 0; i < repetitions; ++i)
+        {
+            samples.push_back(static_cast<double>(c.fn()) / c.ops);
+        }
+        return samples;
+    }
+
+    bool writeJson(const std::vector<Result>& results)
+    {
+        FILE* out = fopen(options_.jsonPath.c_str(), "w");
+        if (!out) return false;
+        fprintf(out, "{\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            fprintf(out, "    {\"name\": \"%s\", \"ops\": %zu, \"median_ns\": %.4f, \"mad_ns\": %.4f, "
+                         "\"min_ns\": %.4f, \"samples\": [",
+                    r.name.c_str(), r.ops, r.medianNs, r.madNs, r.minNs);
+            for (size_t j = 0; j < r.samples.size(); ++j)
+            {
+                fprintf(out, "%s%.4f", j ? ", " : "", r.samples[j]);
+            }
+            fprintf(out, "]}%s\n", i + 1 < results.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        fclose(out);
+        return true;
+    }
+
+private:
+    Options           options_;
+    std::vector<Case> cases_;
+};
+
+} // namespace bench
@@ -0,0 +1,238 @@
+// 碎片与RSS基准：按阶段切换负载（大量小对象、释放大部分、大对象、中等对象、全部释放……），
+// 每个阶段结束时采样 /proc/self/statm 和分配器持有的内存，报告峰值RSS、稳态RSS以及存活字节与映射字节之比。
+// 每个分配器在独立子进程中运行
+// 用法：./fragmentation_bench [--cycles N] [--scale F]
+#include "BenchUtil.h"
+#include "AllocatorBackend.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace
+{
+
+using Allocator = kama_backend::AllocatorBackend;
+
+// 参与对比的后端
+const Allocator* const ALLOCATORS[] = {
+    &kama_backend::v1Backend(),
+    &kama_backend::v2Backend(),
+    &kama_backend::v3Backend(),
+    &kama_backend::systemBackend(),
+};
+
+struct Phase
+{
+    const char* name;
+    enum Kind { GROW, FREE } kind;
+    size_t count;    // GROW：分配个数（乘以scale）
+    size_t minSize;
+    size_t maxSize;
+    double keep;     // FREE：保留比例
+    int    group;    // 对象所属的组，FREE只释放该组，-1表示全部
+};
+
+// 一个周期的各阶段
+const Phase PHASES[] = {
+    {"small_grow",     Phase::GROW, 300000, 16,    256,    0,    0},
+    {"small_free_90%", Phase::FREE, 0,      0,     0,      0.10, 0},
+    {"large_grow",     Phase::GROW, 300,    32768, 393216, 0,    1},
+    {"large_free",     Phase::FREE, 0,      0,     0,      0,    1},
+    {"medium_grow",    Phase::GROW, 10000,  512,   8192,   0,    2},
+    {"free_all",       Phase::FREE, 0,      0,     0,      0,    -1},
+};
+const size_t NUM_PHASES = sizeof(PHASES) / sizeof(PHASES[0]);
+
+// 每个阶段的采样，以double数组经管道传回父进程
+struct PhaseSample
+{
+    double rssMb;
+    double liveMb;
+    double mappedMb; // 不可得时为 RSS 相对基线的增量
+};
+
+double rssMb()
+{
+    long pages = 0;
+    FILE* in = fopen("/proc/self/statm", "r");
+    if (in)
+    {
+        long size;
+        if (fscanf(in, "%ld %ld", &size, &pages) != 2) pages = 0;
+        fclose(in);
+    }
+    return pages * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024 * 1024);
+}
+
+struct Object
+{
+    void*  ptr;
+    size_t size;
+    int    group;
+};
+
+// 运行所有周期，返回 [基线RSS, 峰值RSS, 每阶段(rss, live, mapped)...]
+std::vector<double> runAllocator(const Allocator& a, int cycles, double scale)
+{
+    if (a.init) a.init();
+
+    std::mt19937 gen(42);
+    std::vector<Object> live;
+    size_t maxObjects = 0;
+    for (const Phase& p : PHASES) maxObjects += static_cast<size_t>(p.count * scale);
+    live.reserve(maxObjects);
+
+    double baseline = rssMb();
+    double peak = baseline;
+    size_t liveBytes = 0;
+    std::vector<double> result = {baseline, 0};
+
+    for (int c = 0; c < cycles; ++c)
+    {
+        for (const Phase& p : PHASES)
+        {
+            if (p.kind == Phase::GROW)
+            {
+                std::uniform_int_distribution<size_t> dist(p.minSize, p.maxSize);
+                size_t count = static_cast<size_t>(p.count * scale);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    size_t size = dist(gen);
+                    void* ptr = a.allocate(size);
+                    memset(ptr, 1, size); // 写满对象，使RSS反映实际占用
+                    live.push_back({ptr, size, p.group});
+                    liveBytes += size;
+                    // 阶段中途也采样，捕获峰值
+                    if (i % 4096 == 0) peak = std::max(peak, rssMb());
+                }
+            }
+            else
+            {
+                std::uniform_real_distribution<double> keep(0, 1);
+                size_t kept = 0;
+                for (const Object& obj : live)
+                {
+                    if ((p.group < 0 || obj.group == p.group) && keep(gen) >= p.keep)
+                    {
+                        a.deallocate(obj.ptr, obj.size);
+                        liveBytes -= obj.size;
+                    }
+                    else
+                    {
+                        live[kept++] = obj;
+                    }
+                }
+                live.resize(kept);
+            }
+
+            double rss = rssMb();
+            peak = std::max(peak, rss);
+            double mapped = a.mappedBytes ? a.mappedBytes() / (1024.0 * 1024) : std::max(0.0, rss - baseline);
+            result.insert(result.end(), {rss, liveBytes / (1024.0 * 1024), mapped});
+        }
+    }
+    result[1] = peak;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int cycles = 2;
+    double scale = 1.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--cycles" && hasValue) cycles = std::max(1, atoi(argv[++i]));
+        else if (arg == "--scale" && hasValue) scale = std::max(0.01, atof(argv[++i]));
+        else
+        {
+            fprintf(stderr, "usage: %s [--cycles N] [--scale F]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const size_t numAllocators = sizeof(ALLOCATORS) / sizeof(ALLOCATORS[0]);
+    const size_t numSamples = cycles * NUM_PHASES;
+    std::vector<std::vector<double>> results(numAllocators);
+    for (size_t j = 0; j < numAllocators; ++j)
+    {
+        if (!bench::runInChild([&]() { return runAllocator(*ALLOCATORS[j], cycles, scale); }, results[j])
+            || results[j].size() != 2 + numSamples * 3)
+        {
+            results[j].clear();
+        }
+    }
+    auto sample = [&](size_t j, size_t s) {
+        const double* v = &results[j][2 + s * 3];
+        return PhaseSample{v[0], v[1], v[2]};
+    };
+
+    // 各阶段结束时的RSS与存活/映射比
+    printf("RSS MB at end of each phase (live/mapped %%)\n%-22s %9s", "phase", "live MB");
+    for (const Allocator* a : ALLOCATORS) printf("%20s", a->name);
+    printf("\n");
+    for (size_t s = 0; s < numSamples; ++s)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%d:%s", static_cast<int>(s / NUM_PHASES) + 1, PHASES[s % NUM_PHASES].name);
+        double live = -1;
+        for (size_t j = 0; j < numAllocators && live < 0; ++j)
+        {
+            if (!results[j].empty()) live = sample(j, s).liveMb;
+        }
+        printf("%-22s %9.2f", name, std::max(live, 0.0));
+        for (size_t j = 0; j < numAllocators; ++j)
+        {
+            if (results[j].empty())
+            {
+                printf("%20s", "failed");
+                continue;
+            }
+            PhaseSample p = sample(j, s);
+            char cell[32];
+            if (p.mappedMb > 0)
+                snprintf(cell, sizeof(cell), "%.2f (%3.0f%%)", p.rssMb, p.liveMb / p.mappedMb * 100);
+            else
+                snprintf(cell, sizeof(cell), "%.2f (  -)", p.rssMb);
+            printf("%20s", cell);
+        }
+        printf("\n");
+    }
+
+    // 汇总：稳态RSS取最后一个周期各阶段RSS的中位数；存活/映射比取最后一个周期中仍有存活对象的阶段的平均值
+    printf("\n%-8s %13s %13s %14s %14s %16s\n", "alloc", "base RSS MB", "peak RSS MB", "steady RSS MB",
+           "final RSS MB", "avg live/mapped");
+    for (size_t j = 0; j < numAllocators; ++j)
+    {
+        if (results[j].empty())
+        {
+            printf("%-8s failed\n", ALLOCATORS[j]->name);
+            continue;
+        }
+        std::vector<double> lastCycle;
+        double ratioSum = 0;
+        int ratioCount = 0;
+        for (size_t s = numSamples - NUM_PHASES; s < numSamples; ++s)
+        {
+            PhaseSample p = sample(j, s);
+            lastCycle.push_back(p.rssMb);
+            if (p.liveMb > 0 && p.mappedMb > 0)
+            {
+                ratioSum += p.liveMb / p.mappedMb;
+                ratioCount++;
+            }
+        }
+        printf("%-8s %13.2f %13.2f %14.2f %14.2f %15.0f%%%s\n", ALLOCATORS[j]->name, results[j][0], results[j][1],
+               bench::median(lastCycle), sample(j, numSamples - 1).rssMb,
+               ratioCount ? ratioSum / ratioCount * 100 : 0.0, ALLOCATORS[j]->mappedBytes ? "" : " (vs RSS growth)");
+    }
+    return 0;
+}
@@ -0,0 +1,302 @@
+// 性能回归检查：比较两份 perf_test --json 的结果。
+// 对每个场景用Mann-Whitney U检验比较两组每轮样本，只有差异显著（p < alpha）
+// 且中位数变慢超过允许范围时才判为回归；允许范围取阈值百分比与基线自身波动（3倍MAD）中的较大者，
+// 避免本身抖动大的场景误报。malloc/new对照场景不参与判定，而是用来估计机器整体快慢的变化：
+// 取各对照场景中位数之比的中位数作为系数，比较前先把当前结果除以该系数（--no-normalize关闭）。
+// 存在回归时返回1
+// 用法：./perf_compare baseline.json current.json [--threshold PERCENT] [--alpha P] [--no-normalize]
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct Benchmark
+{
+    double              median = 0;
+    double              mad = 0;
+    std::vector<double> samples;
+};
+
+// 只解析 perf_test 输出所需的JSON子集：对象、数组、字符串（无转义）、数字
+class JsonReader
+{
+public:
+    explicit JsonReader(const std::string& text) : text_(text) {}
+
+    bool parse(std::map<std::string, Benchmark>& out)
+    {
+        // {"benchmarks": [ {...}, ... ]}
+        if (!expect('{')) return false;
+        std::string key;
+        if (!readString(key) || key != "benchmarks" || !expect(':') || !expect('[')) return false;
+        if (peek() == ']') return true;
+        do
+        {
+            std::string name;
+            Benchmark bench;
+            if (!readBenchmark(name, bench)) return false;
+            out[name] = bench;
+        } while (consume(','));
+        return expect(']') && expect('}');
+    }
+
+private:
+    bool readBenchmark(std::string& name, Benchmark& bench)
+    {
+        if (!expect('{')) return false;
+        do
+        {
+            std::string key;
+            if (!readString(key) || !expect(':')) return false;
+            if (key == "name")
+            {
+                if (!readString(name)) return false;
+            }
+            else if (key == "samples")
+            {
+                if (!expect('[')) return false;
+                if (peek() != ']')
+                {
+                    do
+                    {
+                        double v;
+                        if (!readNumber(v)) return false;
+                        bench.samples.push_back(v);
+                    } while (consume(','));
+                }
+                if (!expect(']')) return false;
+            }
+            else
+            {
+                double v;
+                if (!readNumber(v)) return false;
+                if (key == "median_ns") bench.median = v;
+                else if (key == "mad_ns") bench.mad = v;
+            }
+        } while (consume(','));
+        return expect('}');
+    }
+
+    void skipSpace()
+    {
+        while (pos_ < text_.size() && isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+    }
+
+    char peek()
+    {
+        skipSpace();
+        return pos_ < text_.size() ? text_[pos_] : '\0';
+    }
+
+    bool consume(char c)
+    {
+        if (peek() != c) return false;
+        ++pos_;
+        return true;
+    }
+
+    bool expect(char c) { return consume(c); }
+
+    bool readString(std::string& out)
+    {
+        if (!consume('"')) return false;
+        size_t end = text_.find('"', pos_);
+        if (end == std::string::npos) return false;
+        out = text_.substr(pos_, end - pos_);
+        pos_ = end + 1;
+        return true;
+    }
+
+    bool readNumber(double& out)
+    {
+        skipSpace();
+        const char* begin = text_.c_str() + pos_;
+        char* end;
+        out = strtod(begin, &end);
+        if (end == begin) return false;
+        pos_ += end - begin;
+        return true;
+    }
+
+    const std::string& text_;
+    size_t             pos_ = 0;
+};
+
+// 系统分配器的对照场景（名字以/malloc或/new结尾）
+bool isReference(const std::string& name)
+{
+    auto endsWith = [&](const char* suffix) {
+        size_t n = strlen(suffix);
+        return name.size() >= n && name.compare(name.size() - n, n, suffix) == 0;
+    };
+    return endsWith("/malloc") || endsWith("/new");
+}
+
+bool loadResults(const char* path, std::map<std::string, Benchmark>& out)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+    return JsonReader(text).parse(out);
+}
+
+// 双侧Mann-Whitney U检验的p值，正态近似，含并列秩修正与连续性修正
+double mannWhitneyP(const std::vector<double>& a, const std::vector<double>& b)
+{
+    size_t n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    if (n1 == 0 || n2 == 0) return 1.0;
+
+    std::vector<std::pair<double, int>> all;
+    for (double v : a) all.emplace_back(v, 0);
+    for (double v : b) all.emplace_back(v, 1);
+    std::sort(all.begin(), all.end());
+
+    double rankSumA = 0;
+    double tieTerm = 0;
+    for (size_t i = 0; i < n;)
+    {
+        size_t j = i;
+        while (j < n && all[j].first == all[i].first) ++j;
+        double rank = (i + 1 + j) / 2.0; // 并列取平均秩
+        for (size_t k = i; k < j; ++k)
+        {
+            if (all[k].second == 0) rankSumA += rank;
+        }
+        double t = static_cast<double>(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+
+    double u = rankSumA - n1 * (n1 + 1) / 2.0;
+    double mean = n1 * n2 / 2.0;
+    double variance = n1 * n2 / 12.0 * ((n + 1) - tieTerm / (static_cast<double>(n) * (n - 1)));
+    if (variance <= 0) return 1.0;
+    double z = (std::fabs(u - mean) - 0.5) / std::sqrt(variance);
+    return std::erfc(std::max(z, 0.0) / std::sqrt(2.0));
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s baseline.json current.json [--threshold PERCENT] [--alpha P] [--no-normalize]\n", argv[0]);
+        return 2;
+    }
+    // 与perf_check目标的PERF_CHECK_THRESHOLD默认值一致
+    double threshold = 15.0;
+    double alpha = 0.01;
+    bool normalize = true;
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--threshold" && i + 1 < argc) threshold = atof(argv[++i]);
+        else if (arg == "--alpha" && i + 1 < argc) alpha = atof(argv[++i]);
+        else if (arg == "--no-normalize") normalize = false;
+    }
+
+    std::map<std::string, Benchmark> baseline, current;
+    if (!loadResults(argv[1], baseline))
+    {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 2;
+    }
+    if (!loadResults(argv[2], current))
+    {
+        fprintf(stderr, "cannot read %s\n", argv[2]);
+        return 2;
+    }
+
+    // 机器快慢系数
+    std::vector<double> ratios;
+    for (const auto& [name, cur] : current)
+    {
+        auto it = baseline.find(name);
+        if (isReference(name) && it != baseline.end() && it->second.median > 0)
+            ratios.push_back(cur.median / it->second.median);
+    }
+    std::sort(ratios.begin(), ratios.end());
+    double speed = 1.0;
+    if (normalize && !ratios.empty())
+    {
+        size_t mid = ratios.size() / 2;
+        speed = ratios.size() % 2 ? ratios[mid] : (ratios[mid - 1] + ratios[mid]) / 2;
+        for (auto& [name, cur] : current)
+        {
+            if (isReference(name)) continue;
+            cur.median /= speed;
+            for (double& v : cur.samples) v /= speed;
+        }
+        printf("machine speed factor %.3f from %zu reference benchmarks (applied to pool results)\n\n", speed,
+               ratios.size());
+    }
+
+    printf("%-40s %12s %12s %9s %8s %10s  %s\n", "benchmark", "base ns/op", "curr ns/op", "change", "band",
+           "p-value", "verdict");
+    int regressions = 0;
+    int missing = 0;
+    for (const auto& [name, base] : baseline)
+    {
+        auto it = current.find(name);
+        if (it == current.end())
+        {
+            printf("%-40s %12.2f %12s %9s %8s %10s  missing\n", name.c_str(), base.median, "-", "-", "-", "-");
+            missing++;
+            continue;
+        }
+        const Benchmark& cur = it->second;
+        double change = base.median > 0 ? (cur.median - base.median) / base.median * 100 : 0;
+        double band = std::max(threshold, base.median > 0 ? 3 * base.mad / base.median * 100 : 0);
+        double p = mannWhitneyP(base.samples, cur.samples);
+
+        const char* verdict = "ok";
+        if (isReference(name))
+        {
+            verdict = "reference";
+        }
+        else if (p < alpha && change > band)
+        {
+            verdict = "REGRESSION";
+            regressions++;
+        }
+        else if (p < alpha && change < -band)
+        {
+            verdict = "improved";
+        }
+        printf("%-40s %12.2f %12.2f %+8.1f%% %7.1f%% %10.2g  %s\n", name.c_str(), base.median, cur.median, change,
+               band, p, verdict);
+    }
+    for (const auto& [name, cur] : current)
+    {
+        if (!baseline.count(name))
+            printf("%-40s %12s %12.2f %9s %8s %10s  new\n", name.c_str(), "-", cur.median, "-", "-", "-");
+    }
+
+    // 基线中有而当前结果中没有，通常是场景崩溃，同样判为失败
+    if (missing)
+    {
+        printf("\n%d benchmark(s) missing from the current results\n", missing);
+    }
+    if (regressions)
+    {
+        printf("\n%d benchmark(s) regressed beyond their band (threshold %.0f%%, p < %g)\n", regressions, threshold,
+               alpha);
+        return 1;
+    }
+    if (missing) return 1;
+    printf("\nno regressions (threshold %.0f%%, p < %g)\n", threshold, alpha);
+    return 0;
+}
@@ -1,310 +1,511 @@
+// 性能测试：每个场景重复运行并丢弃预热轮，报告每次操作纳秒数的中位数/MAD。
+// 默认每个场景在独立子进程中运行，内存池与malloc/new的结果互不影响；
+// 用法见 BenchUtil.h 中的 printUsage，例如 ./perf_test --reps 20 --cpu 0 --json perf.json
 #include "../include/MemoryPool.h"
+#include "../include/CentralCache.h"
+#include "../include/PageCache.h"
+#include "../include/ObjectPool.h"
+#include "../include/Arena.h"
+#include "../include/HeapProfiler.h"
+#include "../include/LatencyHistogram.h"
+#include "../include/ShardedHeap.h"
+#include "BenchUtil.h"
 #include <iostream>
 #include <vector>
-#include <chrono>
 #include <random>
-#include <iomanip>
-#include <thread>
+#include <algorithm>
+#include <cstring>
 
 using namespace Kama_memoryPool;
-using namespace std::chrono;
+using bench::Suite;
+using bench::nowNs;
+using bench::doNotOptimize;
 
-// 计时器类
-class Timer 
+namespace
 {
-    high_resolution_clock::time_point start;
-public:
-    Timer() : start(high_resolution_clock::now()) {}
-    
-    double elapsed() 
-    {
-        auto end = high_resolution_clock::now();
-        return duration_cast<microseconds>(end - start).count() / 1000.0; // 转换为毫秒
-    }
+
+// 被比较的分配器
+struct Allocator
+{
+    const char* name;
+    void* (*allocate)(size_t size);
+    void  (*deallocate)(void* ptr, size_t size);
 };
 
-// 性能测试类
-class PerformanceTest 
+const Allocator ALLOCATORS[] = {
+    {"pool",
+     [](size_t size) { return MemoryPool::allocate(size); },
+     [](void* ptr, size_t size) { MemoryPool::deallocate(ptr, size); }},
+    {"sharded",
+     [](size_t size) { return ShardedHeap::allocate(size); },
+     [](void* ptr, size_t size) { ShardedHeap::deallocate(ptr, size); }},
+    {"malloc",
+     [](size_t size) { return malloc(size); },
+     [](void* ptr, size_t) { free(ptr); }},
+    {"new",
+     [](size_t size) { return static_cast<void*>(new char[size]); },
+     [](void* ptr, size_t) { delete[] static_cast<char*>(ptr); }},
+};
+
+const size_t MIXED_SIZES[] = {16, 32, 64, 128, 256, 512, 1024, 2048};
+
+// 1. 各层单独测试
+
+// ThreadCache命中：成对分配释放，自由链表长度不变，不会触及中心缓存
+void addThreadCacheBenchmarks(Suite& suite)
 {
-private:
-    // 测试统计信息
-    struct TestStats 
-    {
-        double memPoolTime{0.0};
-        double systemTime{0.0};
-        size_t totalAllocs{0};
-        size_t totalBytes{0};
-    };
+    constexpr size_t OPS = 1000000;
+    suite.add("tier/thread_cache_hit/32B", OPS, []() {
+        uint64_t start = nowNs();
+        for (size_t i = 0; i < OPS; ++i)
+        {
+            void* p = MemoryPool::allocate(32);
+            doNotOptimize(p);
+            MemoryPool::deallocate(p, 32);
+        }
+        return nowNs() - start;
+    });
 
-public:
-    // 1. 系统预热
-    static void warmup() 
-    {
-        std::cout << "Warming up memory systems...\n";
-        // 使用 pair 来存储指针和对应的大小
-        std::vector<std::pair<void*, size_t>> warmupPtrs;
-        
-        // 预热内存池
-        for (int i = 0; i < 1000; ++i) 
+    // 先分配64个再逆序释放，仍全部命中线程缓存
+    constexpr size_t DEPTH = 64;
+    constexpr size_t ROUNDS = OPS / DEPTH;
+    suite.add("tier/thread_cache_hit_lifo64/32B", ROUNDS * DEPTH, []() {
+        void* ptrs[DEPTH];
+        uint64_t start = nowNs();
+        for (size_t r = 0; r < ROUNDS; ++r)
         {
-            for (size_t size : {32, 64, 128, 256, 512}) {
-                void* p = MemoryPool::allocate(size);
-                warmupPtrs.emplace_back(p, size);  // 存储指针和对应的大小
-            }
+            for (size_t i = 0; i < DEPTH; ++i) ptrs[i] = MemoryPool::allocate(32);
+            for (size_t i = DEPTH; i-- > 0;) MemoryPool::deallocate(ptrs[i], 32);
         }
-        
-        // 释放预热内存
-        for (const auto& [ptr, size] : warmupPtrs) 
+        return nowNs() - start;
+    });
+
+    // 大小在8~256字节间轮换，大小类索引只能在运行时计算
+    constexpr size_t NUM_SIZES = 32;
+    suite.add("tier/thread_cache_hit/8_256B", OPS, []() {
+        size_t sizes[NUM_SIZES];
+        for (size_t i = 0; i < NUM_SIZES; ++i) sizes[i] = (i + 1) * 8;
+        doNotOptimize(sizes);
+        uint64_t start = nowNs();
+        for (size_t i = 0; i < OPS; ++i)
         {
-            MemoryPool::deallocate(ptr, size);  // 使用实际分配的大小进行释放
+            size_t size = sizes[i % NUM_SIZES];
+            void* p = MemoryPool::allocate(size);
+            doNotOptimize(p);
+            MemoryPool::deallocate(p, size);
         }
-        
-        std::cout << "Warmup complete.\n\n";
-    }
+        return nowNs() - start;
+    });
+}
 
-    // 2. 小对象分配测试
-    static void testSmallAllocation() 
+// CentralCache补充：直接调用fetchRange/returnRange，每次操作为取出并归还一批
+void addCentralCacheBenchmarks(Suite& suite)
+{
+    constexpr size_t OPS = 100000;
+    for (size_t batch : {1, 32})
     {
-        constexpr size_t NUM_ALLOCS = 100000;
-        constexpr size_t SMALL_SIZE = 32;
-        
-        std::cout << "\nTesting small allocations (" << NUM_ALLOCS << " allocations of " 
-                  << SMALL_SIZE << " bytes):" << std::endl;
-        
-        // 测试内存池
-        {
-            Timer t;
-            std::vector<void*> ptrs;
-            ptrs.reserve(NUM_ALLOCS);
-            
-            for (size_t i = 0; i < NUM_ALLOCS; ++i) 
+        std::string name = "tier/central_fetch_return/64B/batch" + std::to_string(batch);
+        suite.add(name, OPS, [batch]() {
+            CentralCache& central = CentralCache::getInstance();
+            size_t index = SizeClass::getIndex(64);
+            uint64_t start = nowNs();
+            for (size_t i = 0; i < OPS; ++i)
             {
-                ptrs.push_back(MemoryPool::allocate(SMALL_SIZE));
-                
-                // 模拟真实使用：部分立即释放
-                if (i % 4 == 0) 
-                {
-                    MemoryPool::deallocate(ptrs.back(), SMALL_SIZE);
-                    ptrs.pop_back();
-                }
+                size_t fetched = 0;
+                void* list = central.fetchRange(index, batch, fetched);
+                central.returnRange(list, fetched, index);
             }
-            
-            for (void* ptr : ptrs) 
-            {
-                MemoryPool::deallocate(ptr, SMALL_SIZE);
-            }
-            
-            std::cout << "Memory Pool: " << std::fixed << std::setprecision(3) 
-                      << t.elapsed() << " ms" << std::endl;
+            return nowNs() - start;
+        });
+    }
+
+    // 从新span补充：每轮取走一整个span（8B大小类共4096块）而不归还，
+    // 每次操作为一次fetchRange，包含向页缓存申请span的开销
+    constexpr size_t SPAN_BLOCKS = 8 * PageCache::PAGE_SIZE / 8;
+    constexpr size_t REFILL_BATCH = 64;
+    suite.add("tier/central_refill/8B/batch64", SPAN_BLOCKS / REFILL_BATCH, []() {
+        CentralCache& central = CentralCache::getInstance();
+        size_t index = SizeClass::getIndex(8);
+        uint64_t start = nowNs();
+        for (size_t i = 0; i < SPAN_BLOCKS / REFILL_BATCH; ++i)
+        {
+            size_t fetched = 0;
+            doNotOptimize(central.fetchRange(index, REFILL_BATCH, fetched));
         }
-        
-        // 测试new/delete
+        return nowNs() - start;
+    });
+}
+
+// PageCache span分配：固定页数，以及1~64页随机大小、乱序释放以触发切分与合并
+void addPageCacheBenchmarks(Suite& suite)
+{
+    constexpr size_t OPS = 100000;
+    suite.add("tier/page_span/8pages", OPS, []() {
+        PageCache& pages = PageCache::getInstance();
+        uint64_t start = nowNs();
+        for (size_t i = 0; i < OPS; ++i)
         {
-            Timer t;
+            void* span = pages.allocateSpan(8);
+            doNotOptimize(span);
+            pages.deallocateSpan(span, 8);
+        }
+        return nowNs() - start;
+    });
+
+    constexpr size_t LIVE = 256;
+    constexpr size_t ROUNDS = 100;
+    suite.add("tier/page_span/mixed_1_64pages", LIVE * ROUNDS, []() {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<size_t> dist(1, 64);
+        std::vector<size_t> pageCounts(LIVE);
+        std::vector<size_t> order(LIVE);
+        std::vector<void*> spans(LIVE);
+        for (size_t i = 0; i < LIVE; ++i) order[i] = i;
+
+        PageCache& pages = PageCache::getInstance();
+        uint64_t total = 0;
+        for (size_t r = 0; r < ROUNDS; ++r)
+        {
+            for (auto& n : pageCounts) n = dist(gen);
+            std::shuffle(order.begin(), order.end(), gen);
+
+            uint64_t start = nowNs();
+            for (size_t i = 0; i < LIVE; ++i) spans[i] = pages.allocateSpan(pageCounts[i]);
+            for (size_t i : order) pages.deallocateSpan(spans[i], pageCounts[i]);
+            total += nowNs() - start;
+        }
+        return total;
+    });
+}
+
+// 2. 端到端场景，内存池与malloc、new对比
+
+// 小对象：25%立即释放，其余最后统一释放
+void addSmallAllocationBenchmarks(Suite& suite)
+{
+    constexpr size_t NUM_ALLOCS = 100000;
+    constexpr size_t SMALL_SIZE = 32;
+    for (const Allocator& a : ALLOCATORS)
+    {
+        suite.add(std::string("small/32B/") + a.name, NUM_ALLOCS, [&a]() {
             std::vector<void*> ptrs;
             ptrs.reserve(NUM_ALLOCS);
-            
-            for (size_t i = 0; i < NUM_ALLOCS; ++i) 
+            uint64_t start = nowNs();
+            for (size_t i = 0; i < NUM_ALLOCS; ++i)
             {
-                ptrs.push_back(new char[SMALL_SIZE]);
-                
-                if (i % 4 == 0) 
+                ptrs.push_back(a.allocate(SMALL_SIZE));
+                if (i % 4 == 0)
                 {
-                    delete[] static_cast<char*>(ptrs.back());
+                    a.deallocate(ptrs.back(), SMALL_SIZE);
                     ptrs.pop_back();
                 }
             }
-            
-            for (void* ptr : ptrs) 
-            {
-                delete[] static_cast<char*>(ptr);
-            }
-            
-            std::cout << "New/Delete: " << std::fixed << std::setprecision(3) 
-                      << t.elapsed() << " ms" << std::endl;
-        }
+            for (void* ptr : ptrs) a.deallocate(ptr, SMALL_SIZE);
+            return nowNs() - start;
+        });
     }
-    
-    // 3. 多线程测试
-    static void testMultiThreaded() 
+}
+
+// 混合大小：大小序列预先生成，每100次分配批量释放20个
+void addMixedSizeBenchmarks(Suite& suite)
+{
+    constexpr size_t NUM_ALLOCS = 50000;
+    for (const Allocator& a : ALLOCATORS)
     {
-        constexpr size_t NUM_THREADS = 4;
-        constexpr size_t ALLOCS_PER_THREAD = 25000;
-        constexpr size_t MAX_SIZE = 256;
-        
-        std::cout << "\nTesting multi-threaded allocations (" << NUM_THREADS 
-                  << " threads, " << ALLOCS_PER_THREAD << " allocations each):" 
-                  << std::endl;
-        
-        auto threadFunc = [](bool useMemPool) 
-        {
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_int_distribution<> dis(8, MAX_SIZE);
+        suite.add(std::string("mixed/16_2048B/") + a.name, NUM_ALLOCS, [&a]() {
+            std::mt19937 gen(42);
+            std::vector<size_t> sizes(NUM_ALLOCS);
+            for (auto& size : sizes) size = MIXED_SIZES[gen() % 8];
             std::vector<std::pair<void*, size_t>> ptrs;
-            ptrs.reserve(ALLOCS_PER_THREAD);
-            
-            for (size_t i = 0; i < ALLOCS_PER_THREAD; ++i) 
+            ptrs.reserve(NUM_ALLOCS);
+
+            uint64_t start = nowNs();
+            for (size_t i = 0; i < NUM_ALLOCS; ++i)
             {
-                size_t size = dis(gen);
-                void* ptr = useMemPool ? MemoryPool::allocate(size) 
-                                     : new char[size];
-                ptrs.push_back({ptr, size});
-                
-                // 随机释放一些内存
-                if (rand() % 100 < 75) 
-                {  // 75%的概率释放
-                    size_t index = rand() % ptrs.size();
-                    if (useMemPool) {
-                        MemoryPool::deallocate(ptrs[index].first, ptrs[index].second);
-                    } else {
-                        delete[] static_cast<char*>(ptrs[index].first);
+                ptrs.emplace_back(a.allocate(sizes[i]), sizes[i]);
+                if (i % 100 == 0)
+                {
+                    size_t releaseCount = std::min(ptrs.size(), size_t(20));
+                    for (size_t j = 0; j < releaseCount; ++j)
+                    {
+                        a.deallocate(ptrs.back().first, ptrs.back().second);
+                        ptrs.pop_back();
                     }
-                    ptrs[index] = ptrs.back();
-                    ptrs.pop_back();
                 }
             }
-            
-            // 清理剩余内存
-            for (const auto& [ptr, size] : ptrs) 
-            {
-                if (useMemPool) 
-                {
-                    MemoryPool::deallocate(ptr, size);
-                } 
-                else 
+            for (const auto& [ptr, size] : ptrs) a.deallocate(ptr, size);
+            return nowNs() - start;
+        });
+    }
+}
+
+// 多线程：每个线程绑定到不同CPU，75%概率随机释放一个已分配对象
+void addMultiThreadedBenchmarks(Suite& suite)
+{
+    constexpr size_t NUM_THREADS = 4;
+    constexpr size_t ALLOCS_PER_THREAD = 25000;
+    constexpr size_t MAX_SIZE = 256;
+    for (const Allocator& a : ALLOCATORS)
+    {
+        suite.add(std::string("multithread/4threads/") + a.name, NUM_THREADS * ALLOCS_PER_THREAD, [&a]() {
+            return bench::runThreads(NUM_THREADS, [&a](size_t t) {
+                std::mt19937 gen(static_cast<unsigned>(t + 1));
+                std::uniform_int_distribution<size_t> dis(8, MAX_SIZE);
+                std::vector<std::pair<void*, size_t>> ptrs;
+                ptrs.reserve(ALLOCS_PER_THREAD);
+
+                for (size_t i = 0; i < ALLOCS_PER_THREAD; ++i)
                 {
-                    delete[] static_cast<char*>(ptr);
+                    size_t size = dis(gen);
+                    ptrs.emplace_back(a.allocate(size), size);
+                    if (gen() % 100 < 75)
+                    {
+                        size_t index = gen() % ptrs.size();
+                        a.deallocate(ptrs[index].first, ptrs[index].second);
+                        ptrs[index] = ptrs.back();
+                        ptrs.pop_back();
+                    }
                 }
-            }
-        };
-        
-        // 测试内存池
+                for (const auto& [ptr, size] : ptrs) a.deallocate(ptr, size);
+            }, 0);
+        });
+    }
+}
+
+// 批量接口与逐个分配对比
+void addBatchBenchmarks(Suite& suite)
+{
+    constexpr size_t ROUNDS = 2000;
+    constexpr size_t BATCH = 256;
+    constexpr size_t NODE_SIZE = 48;
+
+    suite.add("batch/48B/pool_single", ROUNDS * BATCH, []() {
+        std::vector<void*> ptrs(BATCH);
+        uint64_t start = nowNs();
+        for (size_t r = 0; r < ROUNDS; ++r)
         {
-            Timer t;
-            std::vector<std::thread> threads;
-            
-            for (size_t i = 0; i < NUM_THREADS; ++i) 
-            {
-                threads.emplace_back(threadFunc, true);
-            }
-            
-            for (auto& thread : threads) 
-            {
-                thread.join();
-            }
-            
-            std::cout << "Memory Pool: " << std::fixed << std::setprecision(3) 
-                      << t.elapsed() << " ms" << std::endl;
+            for (size_t i = 0; i < BATCH; ++i) ptrs[i] = MemoryPool::allocate(NODE_SIZE);
+            for (size_t i = 0; i < BATCH; ++i) MemoryPool::deallocate(ptrs[i], NODE_SIZE);
         }
-        
-        // 测试new/delete
+        return nowNs() - start;
+    });
+
+    suite.add("batch/48B/pool_batch", ROUNDS * BATCH, []() {
+        std::vector<void*> ptrs(BATCH);
+        uint64_t start = nowNs();
+        for (size_t r = 0; r < ROUNDS; ++r)
         {
-            Timer t;
-            std::vector<std::thread> threads;
-            
-            for (size_t i = 0; i < NUM_THREADS; ++i) 
-            {
-                threads.emplace_back(threadFunc, false);
-            }
-            
-            for (auto& thread : threads) 
-            {
-                thread.join();
-            }
-            
-            std::cout << "New/Delete: " << std::fixed << std::setprecision(3) 
-                      << t.elapsed() << " ms" << std::endl;
+            MemoryPool::allocateBatch(NODE_SIZE, ptrs.data(), BATCH);
+            MemoryPool::deallocateBatch(NODE_SIZE, ptrs.data(), BATCH);
         }
-    }
-    
-    // 4. 混合大小测试
-    static void testMixedSizes() 
+        return nowNs() - start;
+    });
+}
+
+// 定类型对象：运行时计算大小类、编译期确定大小类、new/delete
+void addObjectPoolBenchmarks(Suite& suite)
+{
+    struct Message
     {
-        constexpr size_t NUM_ALLOCS = 50000;
-        const size_t SIZES[] = {16, 32, 64, 128, 256, 512, 1024, 2048};
-        
-        std::cout << "\nTesting mixed size allocations (" << NUM_ALLOCS 
-                  << " allocations):" << std::endl;
-        
-        // 测试内存池
+        uint64_t id;
+        uint32_t type;
+        uint32_t length;
+        Message* next;
+    };
+    constexpr size_t NUM_OBJECTS = 1000;
+    constexpr size_t ROUNDS = 200;
+
+    suite.add("object/24B/pool", NUM_OBJECTS * ROUNDS, []() {
+        std::vector<Message*> objs(NUM_OBJECTS);
+        uint64_t start = nowNs();
+        for (size_t r = 0; r < ROUNDS; ++r)
         {
-            Timer t;
-            std::vector<std::pair<void*, size_t>> ptrs;
-            ptrs.reserve(NUM_ALLOCS);
-            
-            for (size_t i = 0; i < NUM_ALLOCS; ++i) 
-            {
-                size_t size = SIZES[rand() % 8];
-                void* p = MemoryPool::allocate(size);
-                ptrs.emplace_back(p, size);
-                
-                // 批量释放
-                if (i % 100 == 0 && !ptrs.empty()) 
-                {
-                    size_t releaseCount = std::min(ptrs.size(), size_t(20));
-                    for (size_t j = 0; j < releaseCount; ++j) 
-                    {
-                        MemoryPool::deallocate(ptrs.back().first, ptrs.back().second);
-                        ptrs.pop_back();
-                    }
-                }
-            }
-            
-            for (const auto& [ptr, size] : ptrs) 
-            {
-                MemoryPool::deallocate(ptr, size);
-            }
-            
-            std::cout << "Memory Pool: " << std::fixed << std::setprecision(3) 
-                      << t.elapsed() << " ms" << std::endl;
+            for (size_t i = 0; i < NUM_OBJECTS; ++i)
+                objs[i] = new (MemoryPool::allocate(sizeof(Message))) Message{i, 0, 0, nullptr};
+            for (size_t i = 0; i < NUM_OBJECTS; ++i)
+                MemoryPool::deallocate(objs[i], sizeof(Message));
         }
-        
-        // 测试new/delete
+        return nowNs() - start;
+    });
+
+    suite.add("object/24B/object_pool", NUM_OBJECTS * ROUNDS, []() {
+        std::vector<Message*> objs(NUM_OBJECTS);
+        uint64_t start = nowNs();
+        for (size_t r = 0; r < ROUNDS; ++r)
         {
-            Timer t;
-            std::vector<std::pair<void*, size_t>> ptrs;
-            ptrs.reserve(NUM_ALLOCS);
-            
-            for (size_t i = 0; i < NUM_ALLOCS; ++i) 
+            for (size_t i = 0; i < NUM_OBJECTS; ++i) objs[i] = make<Message>(Message{i, 0, 0, nullptr});
+            for (size_t i = 0; i < NUM_OBJECTS; ++i) destroy(objs[i]);
+        }
+        return nowNs() - start;
+    });
+
+    suite.add("object/24B/new", NUM_OBJECTS * ROUNDS, []() {
+        std::vector<Message*> objs(NUM_OBJECTS);
+        uint64_t start = nowNs();
+        for (size_t r = 0; r < ROUNDS; ++r)
+        {
+            for (size_t i = 0; i < NUM_OBJECTS; ++i) objs[i] = new Message{i, 0, 0, nullptr};
+            for (size_t i = 0; i < NUM_OBJECTS; ++i) delete objs[i];
+        }
+        return nowNs() - start;
+    });
+}
+
+// 请求作用域的小对象：逐个释放与Arena整体重置对比
+void addArenaBenchmarks(Suite& suite)
+{
+    constexpr size_t NUM_OBJECTS = 5000;
+    constexpr size_t ROUNDS = 20;
+
+    auto makeSizes = []() {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<size_t> dist(8, 128);
+        std::vector<size_t> sizes(NUM_OBJECTS);
+        for (auto& size : sizes) size = dist(gen);
+        return sizes;
+    };
+
+    suite.add("arena/8_128B/pool", NUM_OBJECTS * ROUNDS, [makeSizes]() {
+        std::vector<size_t> sizes = makeSizes();
+        std::vector<void*> objs(NUM_OBJECTS);
+        uint64_t start = nowNs();
+        for (size_t r = 0; r < ROUNDS; ++r)
+        {
+            for (size_t i = 0; i < NUM_OBJECTS; ++i) objs[i] = MemoryPool::allocate(sizes[i]);
+            for (size_t i = 0; i < NUM_OBJECTS; ++i) MemoryPool::deallocate(objs[i], sizes[i]);
+        }
+        return nowNs() - start;
+    });
+
+    suite.add("arena/8_128B/arena", NUM_OBJECTS * ROUNDS, [makeSizes]() {
+        std::vector<size_t> sizes = makeSizes();
+        Arena arena(Arena::DEFAULT_CHUNK_PAGES, 8);
+        uint64_t start = nowNs();
+        for (size_t r = 0; r < ROUNDS; ++r)
+        {
+            for (size_t i = 0; i < NUM_OBJECTS; ++i) doNotOptimize(arena.allocate(sizes[i]));
+            arena.reset();
+        }
+        return nowNs() - start;
+    });
+}
+
+// 乱序释放后的局部性：先分配一批对象并打乱顺序释放，再分配同样数量并按分配顺序逐个写入。
+// 计时包含重新分配与写入，重新分配得到的地址越分散写入越慢
+void addLocalityBenchmarks(Suite& suite)
+{
+    constexpr size_t NUM_OBJECTS = 1 << 18;
+    constexpr size_t SIZE = 64;
+    for (const Allocator& a : ALLOCATORS)
+    {
+        suite.add(std::string("locality/64B/") + a.name, NUM_OBJECTS, [&a]() {
+            std::vector<void*> objs(NUM_OBJECTS);
+            for (auto& obj : objs) obj = a.allocate(SIZE);
+            std::shuffle(objs.begin(), objs.end(), std::mt19937(42));
+            for (void* obj : objs) a.deallocate(obj, SIZE);
+
+            uint64_t start = nowNs();
+            for (auto& obj : objs) obj = a.allocate(SIZE);
+            for (void* obj : objs) memset(obj, 1, SIZE);
+            uint64_t elapsed = nowNs() - start;
+            for (void* obj : objs) a.deallocate(obj, SIZE);
+            return elapsed;
+        });
+    }
+}
+
+// 堆分析器开销：同一负载分别在关闭与按默认采样间隔开启时运行
+void addHeapProfilerBenchmarks(Suite& suite)
+{
+    constexpr size_t NUM_ALLOCS = 200000;
+    for (bool enabled : {false, true})
+    {
+        suite.add(enabled ? "profiler/mixed/on" : "profiler/mixed/off", NUM_ALLOCS, [enabled]() {
+            std::vector<std::pair<void*, size_t>> ptrs(NUM_ALLOCS);
+            if (enabled) HeapProfiler::start();
+            uint64_t start = nowNs();
+            for (size_t i = 0; i < NUM_ALLOCS; ++i)
             {
-                size_t size = SIZES[rand() % 8];
-                void* p = new char[size];
-                ptrs.emplace_back(p, size);
-                
-                if (i % 100 == 0 && !ptrs.empty()) 
-                {
-                    size_t releaseCount = std::min(ptrs.size(), size_t(20));
-                    for (size_t j = 0; j < releaseCount; ++j) 
-                    {
-                        delete[] static_cast<char*>(ptrs.back().first);
-                        ptrs.pop_back();
-                    }
-                }
+                size_t size = MIXED_SIZES[i % 8];
+                ptrs[i] = {MemoryPool::allocate(size), size};
             }
-            
-            for (const auto& [ptr, size] : ptrs) 
+            for (const auto& [ptr, size] : ptrs) MemoryPool::deallocate(ptr, size);
+            uint64_t elapsed = nowNs() - start;
+            if (enabled) HeapProfiler::stop();
+            return elapsed;
+        });
+    }
+
+    // 多线程下释放页对齐的块不应在采样表的锁上竞争；每个线程保留一批存活对象，使采样表始终非空
+    constexpr size_t NUM_THREADS = 4;
+    constexpr size_t ALLOCS_PER_THREAD = 50000;
+    constexpr size_t LIVE = 1024;
+    for (bool enabled : {false, true})
+    {
+        suite.add(enabled ? "profiler/4threads_64B/on" : "profiler/4threads_64B/off",
+                  NUM_THREADS * ALLOCS_PER_THREAD, [enabled]() {
+            // 开启时先保留一些对象直到至少有一个被采样
+            std::vector<void*> pinned;
+            if (enabled)
             {
-                delete[] static_cast<char*>(ptr);
+                HeapProfiler::start();
+                while (HeapProfiler::liveSamples() == 0) pinned.push_back(MemoryPool::allocate(4096));
             }
-            
-            std::cout << "New/Delete: " << std::fixed << std::setprecision(3) 
-                      << t.elapsed() << " ms" << std::endl;
-        }
+            uint64_t elapsed = bench::runThreads(NUM_THREADS, [](size_t) {
+                std::vector<void*> live(LIVE);
+                for (void*& ptr : live) ptr = MemoryPool::allocate(64);
+                for (size_t i = 0; i < ALLOCS_PER_THREAD; ++i)
+                {
+                    void*& slot = live[i % LIVE];
+                    MemoryPool::deallocate(slot, 64);
+                    slot = MemoryPool::allocate(64);
+                }
+                for (void* ptr : live) MemoryPool::deallocate(ptr, 64);
+            }, 0);
+            for (void* ptr : pinned) MemoryPool::deallocate(ptr, 4096);
+            if (enabled) HeapProfiler::stop();
+            return elapsed;
+        });
     }
-};
+}
+
+} // namespace
 
-int main() 
+int main(int argc, char* argv[])
 {
-    std::cout << "Starting performance tests..." << std::endl;
-    
-    // 预热系统
-    PerformanceTest::warmup();
-    
-    // 运行测试
-    PerformanceTest::testSmallAllocation();
-    PerformanceTest::testMultiThreaded();
-    PerformanceTest::testMixedSizes();
-    
-    return 0;
-}
\ No newline at end of file
+    bench::Options options;
+    if (!bench::parseOptions(argc, argv, options)) return 1;
+
+    Suite suite(options);
+    addThreadCacheBenchmarks(suite);
+    addCentralCacheBenchmarks(suite);
+    addPageCacheBenchmarks(suite);
+    addSmallAllocationBenchmarks(suite);
+    addMixedSizeBenchmarks(suite);
+    addMultiThreadedBenchmarks(suite);
+    addBatchBenchmarks(suite);
+    addObjectPoolBenchmarks(suite);
+    addArenaBenchmarks(suite);
+    addLocalityBenchmarks(suite);
+    addHeapProfilerBenchmarks(suite);
+
+    std::cout << "Running benchmarks (" << options.warmup << " warm-up + " << options.repetitions
+              << " measured runs each" << (options.fork ? ", one process per benchmark" : "") << ")\n"
+              << std::endl;
+    int ret = suite.run();
+
+#ifdef KAMA_LATENCY_HISTOGRAM
+    // 子进程中的记录不会回到父进程，只在 --no-fork 时有意义
+    if (!options.fork)
+    {
+        std::cout << "\nSlow path latency:" << std::endl;
+        LatencyHistogram::report(stdout);
+    }
+    else
+    {
+        std::cout << "\nSlow path latency is recorded per child process; rerun with --no-fork to see it."
+                  << std::endl;
+    }
+#endif
+    return ret;
+}
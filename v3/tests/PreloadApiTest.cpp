@@ -0,0 +1,330 @@
+// libkamamalloc.so导出接口的行为测试：只使用libc和operator new，不包含内存池头文件，
+// 须在LD_PRELOAD下运行（make preload_test）。测试全部由断言构成，Release构建下同样保留
+#undef NDEBUG
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <malloc.h>
+#include <new>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+const size_t sizes[] = {0, 1, 24, 100, 4096, 40000, 256 * 1024, 256 * 1024 + 1, 3 * 1024 * 1024};
+
+// 经volatile读取，编译器看不到明显过大的常量请求，不会在编译期报警
+size_t opaque(size_t value)
+{
+    volatile size_t result = value;
+    return result;
+}
+
+bool isAligned(const void* ptr, size_t alignment)
+{
+    return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0;
+}
+
+// 确认malloc确实来自替换库，而不是glibc
+void testPreloaded()
+{
+    printf("Running preload check...\n");
+
+    Dl_info info;
+    int found = dladdr(reinterpret_cast<void*>(&malloc), &info);
+    assert(found && info.dli_fname && strstr(info.dli_fname, "kamamalloc"));
+
+    printf("Preload check passed!\n");
+}
+
+void testMalloc()
+{
+    printf("Running malloc test...\n");
+
+    for (size_t size : sizes)
+    {
+        char* ptr = static_cast<char*>(malloc(size));
+        assert(ptr != nullptr && isAligned(ptr, 16));
+        size_t usable = malloc_usable_size(ptr);
+        assert(usable >= size);
+        memset(ptr, 0x5A, usable);
+        free(ptr);
+    }
+
+    // 失败时返回nullptr并设置errno
+    for (size_t size : {SIZE_MAX, SIZE_MAX / 2, size_t(1) << 50})
+    {
+        errno = 0;
+        void* ptr = malloc(size);
+        assert(ptr == nullptr && errno == ENOMEM);
+    }
+    free(nullptr);
+
+    printf("Malloc test passed!\n");
+}
+
+void testCalloc()
+{
+    printf("Running calloc test...\n");
+
+    // 复用之前写脏的块也须清零
+    for (size_t size : sizes)
+    {
+        for (int round = 0; round < 2; ++round)
+        {
+            char* dirty = static_cast<char*>(malloc(size));
+            memset(dirty, 0xFF, malloc_usable_size(dirty));
+            free(dirty);
+
+            unsigned char* ptr = static_cast<unsigned char*>(calloc(1, size));
+            assert(ptr != nullptr);
+            for (size_t i = 0; i < size; ++i) assert(ptr[i] == 0);
+            free(ptr);
+        }
+    }
+
+    // num * size溢出
+    errno = 0;
+    void* ptr = calloc(opaque(SIZE_MAX / 2), 3);
+    assert(ptr == nullptr && errno == ENOMEM);
+
+    printf("Calloc test passed!\n");
+}
+
+void testRealloc()
+{
+    printf("Running realloc test...\n");
+
+    // realloc(nullptr, n)等同malloc，扩展与收缩都保留内容
+    char* ptr = static_cast<char*>(realloc(nullptr, 10));
+    assert(ptr != nullptr);
+    memcpy(ptr, "kama", 5);
+    for (size_t size : {size_t(100), size_t(5000), size_t(300000), size_t(4 * 1024 * 1024), size_t(64)})
+    {
+        ptr = static_cast<char*>(realloc(ptr, size));
+        assert(ptr != nullptr && strcmp(ptr, "kama") == 0);
+        assert(malloc_usable_size(ptr) >= size);
+    }
+
+    // 失败时原块保持有效
+    errno = 0;
+    void* failed = realloc(ptr, opaque(SIZE_MAX));
+    assert(failed == nullptr && errno == ENOMEM);
+    errno = 0;
+    failed = reallocarray(ptr, opaque(SIZE_MAX / 2), 3);
+    assert(failed == nullptr && errno == ENOMEM);
+    assert(strcmp(ptr, "kama") == 0);
+
+    ptr = static_cast<char*>(reallocarray(ptr, 100, 8));
+    assert(ptr != nullptr && malloc_usable_size(ptr) >= 800 && strcmp(ptr, "kama") == 0);
+
+    // realloc(p, 0)释放p并返回nullptr，与glibc一致
+    void* zero = realloc(ptr, 0);
+    assert(zero == nullptr);
+
+    printf("Realloc test passed!\n");
+}
+
+void testAligned()
+{
+    printf("Running aligned allocation test...\n");
+
+    for (size_t alignment = sizeof(void*); alignment <= 2 * 1024 * 1024; alignment <<= 1)
+    {
+        for (size_t size : {size_t(1), size_t(100), size_t(5000), size_t(300000)})
+        {
+            void* ptr = nullptr;
+            int ret = posix_memalign(&ptr, alignment, size);
+            assert(ret == 0 && ptr != nullptr && isAligned(ptr, alignment));
+            assert(malloc_usable_size(ptr) >= size);
+            memset(ptr, 0x11, size);
+            free(ptr);
+
+            ptr = aligned_alloc(alignment, size);
+            assert(ptr != nullptr && isAligned(ptr, alignment));
+            memset(ptr, 0x22, size);
+            free(ptr);
+
+            ptr = memalign(alignment, size);
+            assert(ptr != nullptr && isAligned(ptr, alignment));
+            free(ptr);
+        }
+    }
+
+    // 非法对齐返回EINVAL，失败时不修改memptr
+    void* untouched = &untouched;
+    int ret = posix_memalign(&untouched, 3, 16);
+    assert(ret == EINVAL && untouched == &untouched);
+    ret = posix_memalign(&untouched, sizeof(void*) / 2, 16);
+    assert(ret == EINVAL);
+    ret = posix_memalign(&untouched, 64, SIZE_MAX);
+    assert(ret == ENOMEM && untouched == &untouched);
+    ret = posix_memalign(&untouched, 1 << 16, SIZE_MAX - 4096);
+    assert(ret == ENOMEM && untouched == &untouched);
+
+    errno = 0;
+    void* ptr = aligned_alloc(48, 16);
+    assert(ptr == nullptr && errno == EINVAL);
+
+    void* page = valloc(100);
+    assert(page != nullptr && isAligned(page, 4096));
+    free(page);
+    page = pvalloc(100);
+    assert(page != nullptr && isAligned(page, 4096) && malloc_usable_size(page) >= 4096);
+    free(page);
+
+    printf("Aligned allocation test passed!\n");
+}
+
+struct alignas(64) CacheLine
+{
+    char data[64];
+};
+
+struct alignas(8192) TwoPages
+{
+    char data[100];
+};
+
+struct alignas(65536) Huge
+{
+    char data[64];
+};
+
+template<typename T>
+void checkAlignedNew()
+{
+    T* obj = new T;
+    assert(isAligned(obj, alignof(T)));
+    memset(obj, 1, sizeof(T));
+    delete obj;
+
+    T* array = new T[5];
+    assert(isAligned(array, alignof(T)));
+    memset(array, 2, sizeof(T) * 5);
+    delete[] array;
+
+    T* nothrow = new (std::nothrow) T;
+    assert(nothrow != nullptr && isAligned(nothrow, alignof(T)));
+    delete nothrow;
+
+    // 显式调用各对齐版本的operator new/delete
+    std::align_val_t alignment{alignof(T)};
+    void* raw = operator new(sizeof(T), alignment);
+    assert(isAligned(raw, alignof(T)));
+    operator delete(raw, sizeof(T), alignment);
+    raw = operator new[](sizeof(T) * 3, alignment);
+    assert(isAligned(raw, alignof(T)));
+    operator delete[](raw, sizeof(T) * 3, alignment);
+    raw = operator new(sizeof(T), alignment, std::nothrow);
+    assert(raw != nullptr && isAligned(raw, alignof(T)));
+    operator delete(raw, alignment, std::nothrow);
+}
+
+void testOperatorNew()
+{
+    printf("Running operator new test...\n");
+
+    for (size_t size : sizes)
+    {
+        void* ptr = operator new(size);
+        assert(ptr != nullptr && isAligned(ptr, 16));
+        operator delete(ptr, size);
+        ptr = operator new[](size);
+        operator delete[](ptr);
+    }
+    checkAlignedNew<CacheLine>();
+    checkAlignedNew<TwoPages>();
+    checkAlignedNew<Huge>();
+
+    bool thrown = false;
+    try
+    {
+        void* ptr = operator new(SIZE_MAX);
+        operator delete(ptr);
+    }
+    catch (const std::bad_alloc&)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    void* ptr = operator new(SIZE_MAX, std::nothrow);
+    assert(ptr == nullptr);
+
+    printf("Operator new test passed!\n");
+}
+
+// 其他线程不停分配释放时fork，子进程中malloc不能因继承了被持有的锁而死锁
+void testFork()
+{
+    printf("Running fork test...\n");
+
+    bool stop = false;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t)
+    {
+        workers.emplace_back([&stop, t]() {
+            uint32_t seed = t + 1;
+            while (!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+            {
+                void* ptrs[32];
+                for (size_t i = 0; i < 32; ++i)
+                {
+                    seed = seed * 1103515245 + 12345;
+                    ptrs[i] = malloc(i % 8 == 0 ? 300000 + seed % 100000 : seed % 2000);
+                }
+                for (void* ptr : ptrs) free(ptr);
+            }
+        });
+    }
+
+    for (int i = 0; i < 20; ++i)
+    {
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0)
+        {
+            // 死锁时由SIGALRM结束子进程
+            alarm(10);
+            void* small = malloc(100);
+            void* large = malloc(1 << 20);
+            std::thread([]() { free(malloc(64)); }).join();
+            free(small);
+            free(large);
+            _exit(small && large ? 0 : 1);
+        }
+        int status = 0;
+        pid_t waited = waitpid(pid, &status, 0);
+        assert(waited == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    for (auto& worker : workers) worker.join();
+
+    printf("Fork test passed!\n");
+}
+
+} // namespace
+
+int main()
+{
+    printf("Starting preload API tests...\n");
+
+    testPreloaded();
+    testMalloc();
+    testCalloc();
+    testRealloc();
+    testAligned();
+    testOperatorNew();
+    testFork();
+
+    printf("All preload API tests passed!\n");
+    return 0;
+}
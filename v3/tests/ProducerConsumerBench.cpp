@@ -0,0 +1,289 @@
+// 生产者-消费者基准：生产者分配消息经无锁队列交给消费者释放，所有释放都发生在另一个线程上。
+// 除吞吐外，采样线程定期记录各层缓存的空闲字节数与RSS，用于观察内存是否逐渐滞留在消费者的线程缓存中
+// 用法：./producer_consumer_bench [--producers N] [--consumers N] [--messages N] [--size MIN[-MAX]]
+//       [--queue N] [--interval MS] [--allocator pool|malloc] [--csv FILE]
+#include "../include/MemoryPool.h"
+#include "BenchUtil.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace Kama_memoryPool;
+
+namespace
+{
+
+// 有界无锁多生产者多消费者队列（Vyukov）：每个槽的序号指示它当前可写还是可读
+template<typename T>
+class MpmcQueue
+{
+public:
+    // capacity须为2的幂
+    explicit MpmcQueue(size_t capacity) : mask_(capacity - 1), cells_(capacity)
+    {
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(const T& value)
+    {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.data = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // 队列满
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(T& value)
+    {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = cell.data;
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // 队列空
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T                   data;
+    };
+
+    const size_t      mask_;
+    std::vector<Cell> cells_;
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    alignas(64) std::atomic<size_t> dequeuePos_{0};
+};
+
+struct Message
+{
+    void*  ptr;
+    size_t size;
+};
+
+struct Sample
+{
+    double ms;
+    double threadCacheMb;
+    double centralCacheMb;
+    double pageCacheMb;
+    double rssMb;
+};
+
+double rssMb()
+{
+    long pages = 0;
+    FILE* in = fopen("/proc/self/statm", "r");
+    if (in)
+    {
+        long size;
+        if (fscanf(in, "%ld %ld", &size, &pages) != 2) pages = 0;
+        fclose(in);
+    }
+    return pages * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024 * 1024);
+}
+
+Sample takeSample(uint64_t start, bool usePool)
+{
+    Sample s{(bench::nowNs() - start) / 1e6, 0, 0, 0, rssMb()};
+    if (usePool)
+    {
+        PoolStats stats = MemoryPool::getStats();
+        s.threadCacheMb = stats.threadCacheBytes / (1024.0 * 1024);
+        s.centralCacheMb = stats.centralCacheBytes / (1024.0 * 1024);
+        s.pageCacheMb = stats.pageCacheFreeBytes / (1024.0 * 1024);
+    }
+    return s;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t producers = 1;
+    size_t consumers = 1;
+    size_t messages = 2000000; // 每个生产者
+    size_t minSize = 64;
+    size_t maxSize = 64;
+    size_t queueCapacity = 4096;
+    int intervalMs = 50;
+    bool usePool = true;
+    std::string csvPath;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--producers" && hasValue) producers = std::max(1, atoi(argv[++i]));
+        else if (arg == "--consumers" && hasValue) consumers = std::max(1, atoi(argv[++i]));
+        else if (arg == "--messages" && hasValue) messages = std::max(1, atoi(argv[++i]));
+        else if (arg == "--queue" && hasValue) queueCapacity = std::max(2, atoi(argv[++i]));
+        else if (arg == "--interval" && hasValue) intervalMs = std::max(1, atoi(argv[++i]));
+        else if (arg == "--csv" && hasValue) csvPath = argv[++i];
+        else if (arg == "--size" && hasValue)
+        {
+            const char* value = argv[++i];
+            minSize = maxSize = strtoul(value, nullptr, 10);
+            if (const char* dash = strchr(value, '-')) maxSize = strtoul(dash + 1, nullptr, 10);
+            minSize = std::max<size_t>(minSize, 1);
+            maxSize = std::max(maxSize, minSize);
+        }
+        else if (arg == "--allocator" && hasValue)
+        {
+            std::string name = argv[++i];
+            if (name != "pool" && name != "malloc")
+            {
+                fprintf(stderr, "unknown allocator %s\n", name.c_str());
+                return 1;
+            }
+            usePool = name == "pool";
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--producers N] [--consumers N] [--messages N] [--size MIN[-MAX]] "
+                            "[--queue N] [--interval MS] [--allocator pool|malloc] [--csv FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    // 向上取到2的幂
+    size_t capacity = 2;
+    while (capacity < queueCapacity) capacity <<= 1;
+
+    MpmcQueue<Message> queue(capacity);
+    std::atomic<size_t> producersLeft{producers};
+    std::atomic<bool> running{true};
+    std::vector<Sample> samples;
+    uint64_t start = bench::nowNs();
+
+    // 采样线程不分配内存池内存，不会出现在线程缓存统计中
+    std::thread sampler([&]() {
+        while (running.load(std::memory_order_acquire))
+        {
+            samples.push_back(takeSample(start, usePool));
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+        }
+    });
+
+    uint64_t elapsed = bench::runThreads(producers + consumers, [&](size_t t) {
+        if (t < producers)
+        {
+            std::mt19937 gen(static_cast<unsigned>(t + 1));
+            std::uniform_int_distribution<size_t> sizeDist(minSize, maxSize);
+            for (size_t i = 0; i < messages; ++i)
+            {
+                size_t size = sizeDist(gen);
+                void* ptr = usePool ? MemoryPool::allocate(size) : malloc(size);
+                // 写入首字节，模拟填充消息
+                *static_cast<char*>(ptr) = static_cast<char>(i);
+                Message msg{ptr, size};
+                while (!queue.push(msg)) std::this_thread::yield();
+            }
+            producersLeft.fetch_sub(1, std::memory_order_release);
+        }
+        else
+        {
+            Message msg;
+            for (;;)
+            {
+                if (queue.pop(msg))
+                {
+                    bench::doNotOptimize(*static_cast<char*>(msg.ptr));
+                    if (usePool) MemoryPool::deallocate(msg.ptr, msg.size);
+                    else free(msg.ptr);
+                }
+                else if (producersLeft.load(std::memory_order_acquire) == 0)
+                {
+                    // 生产者全部结束后队列为空即可退出
+                    if (!queue.pop(msg)) break;
+                    if (usePool) MemoryPool::deallocate(msg.ptr, msg.size);
+                    else free(msg.ptr);
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    });
+
+    running.store(false, std::memory_order_release);
+    sampler.join();
+    // 所有工作线程已退出，线程缓存已归还中心缓存
+    Sample afterExit = takeSample(start, usePool);
+
+    size_t total = producers * messages;
+    printf("%s: %zu producers, %zu consumers, %zu messages of %zu-%zu bytes, queue %zu\n",
+           usePool ? "pool" : "malloc", producers, consumers, total, minSize, maxSize, capacity);
+    printf("throughput: %.2f M messages/s (%.1f ms)\n\n", total * 1000.0 / elapsed, elapsed / 1e6);
+
+    printf("%10s %14s %14s %14s %10s\n", "time ms", "thread MB", "central MB", "page free MB", "RSS MB");
+    auto print = [](const Sample& s, const char* note) {
+        printf("%10.0f %14.2f %14.2f %14.2f %10.2f%s\n", s.ms, s.threadCacheMb, s.centralCacheMb, s.pageCacheMb,
+               s.rssMb, note);
+    };
+    for (const Sample& s : samples) print(s, "");
+    print(afterExit, "  (after threads exit)");
+
+    if (!csvPath.empty())
+    {
+        FILE* csv = fopen(csvPath.c_str(), "w");
+        if (!csv)
+        {
+            fprintf(stderr, "cannot write %s\n", csvPath.c_str());
+            return 1;
+        }
+        fprintf(csv, "ms,thread_cache_mb,central_cache_mb,page_cache_mb,rss_mb\n");
+        samples.push_back(afterExit);
+        for (const Sample& s : samples)
+        {
+            fprintf(csv, "%.1f,%.4f,%.4f,%.4f,%.4f\n", s.ms, s.threadCacheMb, s.centralCacheMb, s.pageCacheMb, s.rssMb);
+        }
+        fclose(csv);
+    }
+    return 0;
+}
@@ -0,0 +1,318 @@
+// 分配轨迹回放：按记录时的线程数重放轨迹，对比v1、v2、v3内存池、glibc malloc和new/delete
+// 录制：KAMA_TRACE=app.trace LD_PRELOAD=./libkamamalloc.so ./app
+// 回放：./replay_bench app.trace [v1|v2|v3|system|new ...]
+#include "../include/LatencyHistogram.h"
+#include "../include/TraceRecorder.h"
+#include "AllocatorBackend.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace Kama_memoryPool;
+
+namespace
+{
+
+// 回放用的操作，对象地址已换算成编号
+struct ReplayOp
+{
+    uint64_t slot;
+    uint32_t size;
+    uint8_t  op;
+};
+
+struct Trace
+{
+    std::vector<std::vector<ReplayOp>> threads;
+    size_t numSlots = 0;
+    size_t numOps = 0;
+    size_t dropped = 0; // 找不到对应分配的释放（录制开始前分配的对象）
+};
+
+using Backend = kama_backend::AllocatorBackend;
+
+const Backend NEW_BACKEND = {
+    "new",
+    nullptr,
+    [](size_t size) { return ::operator new(size); },
+    [](void* ptr, size_t) { ::operator delete(ptr); },
+    nullptr,
+};
+
+const Backend* const BACKENDS[] = {
+    &kama_backend::v1Backend(),
+    &kama_backend::v2Backend(),
+    &kama_backend::v3Backend(),
+    &kama_backend::systemBackend(),
+    &NEW_BACKEND,
+};
+
+// 子进程通过管道交回的结果
+struct ReplayResult
+{
+    double   seconds;
+    long     baselineRssKb;
+    long     peakRssKb;
+    double   allocLatency[3]; // p50/p99/p999，纳秒
+    double   freeLatency[3];
+};
+
+bool loadTrace(const char* path, Trace& trace)
+{
+    FILE* in = fopen(path, "rb");
+    if (!in) return false;
+
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, "KAMATRC1", 8) != 0
+        || header.recordSize != sizeof(TraceRecord))
+    {
+        fclose(in);
+        return false;
+    }
+
+    std::vector<TraceRecord> records;
+    TraceRecord buf[4096];
+    size_t n;
+    while ((n = fread(buf, sizeof(TraceRecord), 4096, in)) > 0)
+    {
+        records.insert(records.end(), buf, buf + n);
+    }
+    fclose(in);
+
+    // 各线程的记录是分块写入的，按时间戳归并成全局顺序
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TraceRecord& a, const TraceRecord& b) { return a.timestamp < b.timestamp; });
+
+    std::map<uint16_t, size_t> threadIndex;
+    std::unordered_map<uint64_t, uint64_t> liveSlots;
+    for (const TraceRecord& rec : records)
+    {
+        auto it = threadIndex.find(rec.thread);
+        if (it == threadIndex.end())
+        {
+            it = threadIndex.emplace(rec.thread, trace.threads.size()).first;
+            trace.threads.emplace_back();
+        }
+
+        ReplayOp op{0, rec.size, rec.op};
+        if (rec.op == static_cast<uint8_t>(TraceOp::ALLOC))
+        {
+            op.slot = trace.numSlots++;
+            liveSlots[rec.ptr] = op.slot;
+        }
+        else
+        {
+            auto slot = liveSlots.find(rec.ptr);
+            if (slot == liveSlots.end())
+            {
+                trace.dropped++;
+                continue;
+            }
+            op.slot = slot->second;
+            liveSlots.erase(slot);
+        }
+        trace.threads[it->second].push_back(op);
+        trace.numOps++;
+    }
+    return true;
+}
+
+long currentMaxRssKb()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void percentiles(const std::vector<uint64_t>& counts, double out[3])
+{
+    uint64_t total = 0;
+    for (uint64_t c : counts) total += c;
+    const double qs[3] = {0.50, 0.99, 0.999};
+    for (int i = 0; i < 3; ++i)
+    {
+        out[i] = 0;
+        if (total == 0) continue;
+        uint64_t rank = static_cast<uint64_t>(qs[i] * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < counts.size(); ++b)
+        {
+            seen += counts[b];
+            if (seen >= rank)
+            {
+                out[i] = LatencyHistogram::bucketUpperBound(b) / LatencyHistogram::cyclesPerNs();
+                break;
+            }
+        }
+    }
+}
+
+ReplayResult replay(const Trace& trace, const Backend& backend)
+{
+    ReplayResult result{};
+    if (backend.init) backend.init();
+    result.baselineRssKb = currentMaxRssKb();
+
+    std::vector<std::atomic<void*>> slots(trace.numSlots);
+    size_t numThreads = trace.threads.size();
+    std::vector<std::vector<uint64_t>> allocHist(numThreads, std::vector<uint64_t>(LatencyHistogram::BUCKET_COUNT));
+    std::vector<std::vector<uint64_t>> freeHist(numThreads, std::vector<uint64_t>(LatencyHistogram::BUCKET_COUNT));
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+
+    auto worker = [&](size_t t) {
+        ready.fetch_add(1);
+        while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+
+        for (const ReplayOp& op : trace.threads[t])
+        {
+            if (op.op == static_cast<uint8_t>(TraceOp::ALLOC))
+            {
+                uint64_t begin = LatencyHistogram::now();
+                void* ptr = backend.allocate(op.size);
+                allocHist[t][LatencyHistogram::bucketOf(LatencyHistogram::now() - begin)]++;
+                // 与真实程序一样写入内存，使RSS可比
+                if (ptr) *static_cast<char*>(ptr) = 0;
+                slots[op.slot].store(ptr, std::memory_order_release);
+            }
+            else
+            {
+                // 对象可能由其他线程分配，等待其分配完成
+                void* ptr;
+                while (!(ptr = slots[op.slot].load(std::memory_order_acquire)))
+                    std::this_thread::yield();
+                uint64_t begin = LatencyHistogram::now();
+                backend.deallocate(ptr, op.size);
+                freeHist[t][LatencyHistogram::bucketOf(LatencyHistogram::now() - begin)]++;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back(worker, t);
+    }
+    while (ready.load() < numThreads) std::this_thread::yield();
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.peakRssKb = currentMaxRssKb();
+
+    for (size_t t = 1; t < numThreads; ++t)
+    {
+        for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT; ++b)
+        {
+            allocHist[0][b] += allocHist[t][b];
+            freeHist[0][b] += freeHist[t][b];
+        }
+    }
+    if (numThreads > 0)
+    {
+        percentiles(allocHist[0], result.allocLatency);
+        percentiles(freeHist[0], result.freeLatency);
+    }
+    return result;
+}
+
+// 每个后端在独立的子进程中回放，互不影响RSS和缓存状态
+bool replayInChild(const Trace& trace, const Backend& backend, ReplayResult& result)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0)
+    {
+        close(fds[0]);
+        ReplayResult r = replay(trace, backend);
+        ssize_t written = write(fds[1], &r, sizeof(r));
+        _exit(written == sizeof(r) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    bool ok = read(fds[0], &result, sizeof(result)) == sizeof(result);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <trace file> [v1|v2|v3|system|new ...]" << std::endl;
+        return 1;
+    }
+
+    Trace trace;
+    if (!loadTrace(argv[1], trace))
+    {
+        std::cerr << "cannot read trace " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::vector<const Backend*> backends;
+    for (int i = 2; i < argc; ++i)
+    {
+        for (const Backend* backend : BACKENDS)
+        {
+            if (strcmp(argv[i], backend->name) == 0) backends.push_back(backend);
+        }
+    }
+    if (backends.empty())
+    {
+        backends.assign(std::begin(BACKENDS), std::end(BACKENDS));
+    }
+
+    std::cout << "Trace: " << trace.numOps << " ops, " << trace.numSlots << " objects, "
+              << trace.threads.size() << " threads";
+    if (trace.dropped) std::cout << " (" << trace.dropped << " frees without a recorded alloc skipped)";
+    std::cout << std::endl;
+
+    // 校准放在fork之前，避免每个子进程各等待一次
+    LatencyHistogram::cyclesPerNs();
+
+    std::cout << std::left << std::setw(8) << "backend" << std::right
+              << std::setw(14) << "Mops/s" << std::setw(14) << "peak RSS MB" << std::setw(14) << "base RSS MB"
+              << std::setw(26) << "alloc p50/p99/p999 ns" << std::setw(26) << "free p50/p99/p999 ns" << std::endl;
+    for (const Backend* backend : backends)
+    {
+        ReplayResult r;
+        if (!replayInChild(trace, *backend, r))
+        {
+            std::cout << std::left << std::setw(8) << backend->name << " failed" << std::endl;
+            continue;
+        }
+
+        char alloc[64], dealloc[64];
+        snprintf(alloc, sizeof(alloc), "%.0f/%.0f/%.0f", r.allocLatency[0], r.allocLatency[1], r.allocLatency[2]);
+        snprintf(dealloc, sizeof(dealloc), "%.0f/%.0f/%.0f", r.freeLatency[0], r.freeLatency[1], r.freeLatency[2]);
+        std::cout << std::left << std::setw(8) << backend->name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(14) << trace.numOps / r.seconds / 1e6
+                  << std::setw(14) << r.peakRssKb / 1024.0 << std::setw(14) << r.baselineRssKb / 1024.0
+                  << std::setw(26) << alloc << std::setw(26) << dealloc << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,261 @@
+// 线程扩展性基准：线程数从1扫到硬件线程数，对比v1、v2、v3（含分片小对象堆）与系统分配器在各负载下的总吞吐。
+// 每个线程执行相同数量的操作，吞吐按墙钟时间计算（而非各线程CPU时间之和），
+// 每个分配器在独立子进程中运行；取多轮的中位数
+// 用法：./scalability_bench [--max-threads N] [--ops N] [--reps N] [--workload NAME] [--csv FILE]
+#include "BenchUtil.h"
+#include "AllocatorBackend.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using Allocator = kama_backend::AllocatorBackend;
+
+// 参与对比的后端
+const Allocator* const ALLOCATORS[] = {
+    &kama_backend::v1Backend(),
+    &kama_backend::v2Backend(),
+    &kama_backend::v3Backend(),
+    &kama_backend::v3ShardedBackend(),
+    &kama_backend::systemBackend(),
+};
+
+const size_t BATCH = 64;
+const size_t OBJECT_SIZE = 64;
+
+// 同一大小：每轮分配64个再按分配顺序释放
+uint64_t runSameSize(const Allocator& a, size_t numThreads, size_t opsPerThread)
+{
+    return bench::runThreads(numThreads, [&](size_t) {
+        void* ptrs[BATCH];
+        for (size_t done = 0; done < opsPerThread; done += BATCH)
+        {
+            for (size_t i = 0; i < BATCH; ++i) ptrs[i] = a.allocate(OBJECT_SIZE);
+            for (size_t i = 0; i < BATCH; ++i) a.deallocate(ptrs[i], OBJECT_SIZE);
+        }
+    });
+}
+
+// 随机大小：维持1024个存活对象，每次随机替换其中一个，大小在8~1024字节间均匀分布
+uint64_t runRandomSizes(const Allocator& a, size_t numThreads, size_t opsPerThread)
+{
+    const size_t LIVE = 1024;
+    const size_t SEQUENCE = 4096;
+    // 随机序列在计时前生成
+    std::vector<std::vector<std::pair<size_t, size_t>>> sequences(numThreads);
+    for (size_t t = 0; t < numThreads; ++t)
+    {
+        std::mt19937 gen(static_cast<unsigned>(t + 1));
+        std::uniform_int_distribution<size_t> sizeDist(8, 1024);
+        std::uniform_int_distribution<size_t> slotDist(0, LIVE - 1);
+        for (size_t i = 0; i < SEQUENCE; ++i) sequences[t].emplace_back(slotDist(gen), sizeDist(gen));
+    }
+
+    return bench::runThreads(numThreads, [&](size_t t) {
+        const auto& seq = sequences[t];
+        std::vector<std::pair<void*, size_t>> live(LIVE);
+        for (size_t i = 0; i < LIVE; ++i)
+        {
+            size_t size = seq[i].second;
+            live[i] = {a.allocate(size), size};
+        }
+        for (size_t i = 0; i < opsPerThread; ++i)
+        {
+            auto [slot, size] = seq[i % SEQUENCE];
+            a.deallocate(live[slot].first, live[slot].second);
+            live[slot] = {a.allocate(size), size};
+        }
+        for (const auto& [ptr, size] : live) a.deallocate(ptr, size);
+    });
+}
+
+// 跨线程释放：线程i每分配64个对象就串成链交给线程i+1，并释放从线程i-1收到的对象。
+// 对象首字为链内下一个对象，链头第二字为邮箱中下一条链
+struct alignas(64) Mailbox
+{
+    std::atomic<void*> head{nullptr};
+};
+
+void pushChain(Mailbox& box, void* chain)
+{
+    void* old = box.head.load(std::memory_order_relaxed);
+    do
+    {
+        static_cast<void**>(chain)[1] = old;
+    } while (!box.head.compare_exchange_weak(old, chain, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void drainMailbox(Mailbox& box, const Allocator& a)
+{
+    void* chain = box.head.exchange(nullptr, std::memory_order_acquire);
+    while (chain)
+    {
+        void* nextChain = static_cast<void**>(chain)[1];
+        for (void* obj = chain; obj;)
+        {
+            void* next = *static_cast<void**>(obj);
+            a.deallocate(obj, OBJECT_SIZE);
+            obj = next;
+        }
+        chain = nextChain;
+    }
+}
+
+uint64_t runCrossThread(const Allocator& a, size_t numThreads, size_t opsPerThread)
+{
+    std::vector<Mailbox> mailboxes(numThreads);
+    std::atomic<size_t> producing{numThreads};
+
+    return bench::runThreads(numThreads, [&](size_t t) {
+        Mailbox& next = mailboxes[(t + 1) % numThreads];
+        for (size_t done = 0; done < opsPerThread; done += BATCH)
+        {
+            void* chain = nullptr;
+            for (size_t i = 0; i < BATCH; ++i)
+            {
+                void* obj = a.allocate(OBJECT_SIZE);
+                *static_cast<void**>(obj) = chain;
+                chain = obj;
+            }
+            pushChain(next, chain);
+            drainMailbox(mailboxes[t], a);
+        }
+
+        // 所有线程都停止发送后，再收一次即可取完
+        producing.fetch_sub(1, std::memory_order_acq_rel);
+        while (producing.load(std::memory_order_acquire) > 0)
+        {
+            drainMailbox(mailboxes[t], a);
+            std::this_thread::yield();
+        }
+        drainMailbox(mailboxes[t], a);
+    });
+}
+
+struct Workload
+{
+    const char* name;
+    const char* description;
+    uint64_t (*run)(const Allocator& a, size_t numThreads, size_t opsPerThread);
+};
+
+const Workload WORKLOADS[] = {
+    {"same_size", "64B, alloc/free in batches of 64", runSameSize},
+    {"random_sizes", "8-1024B, 1024 live objects per thread, random replacement", runRandomSizes},
+    {"cross_thread", "64B, each batch of 64 freed by the next thread in a ring", runCrossThread},
+};
+
+// 1..N全部测试；N较大时取2的幂再加上N
+std::vector<size_t> threadCounts(size_t maxThreads)
+{
+    std::vector<size_t> counts;
+    for (size_t n = 1; n <= maxThreads; n = maxThreads <= 8 ? n + 1 : n * 2)
+    {
+        counts.push_back(n);
+    }
+    if (counts.back() != maxThreads) counts.push_back(maxThreads);
+    return counts;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t maxThreads = bench::cpuCount();
+    size_t opsPerThread = 200000;
+    int repetitions = 3;
+    std::string filter;
+    std::string csvPath;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--max-threads" && hasValue) maxThreads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--ops" && hasValue) opsPerThread = std::max(1, atoi(argv[++i]));
+        else if (arg == "--reps" && hasValue) repetitions = std::max(1, atoi(argv[++i]));
+        else if (arg == "--workload" && hasValue) filter = argv[++i];
+        else if (arg == "--csv" && hasValue) csvPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--max-threads N] [--ops N] [--reps N] [--workload NAME] [--csv FILE]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    opsPerThread = (opsPerThread + BATCH - 1) / BATCH * BATCH;
+
+    FILE* csv = nullptr;
+    if (!csvPath.empty())
+    {
+        csv = fopen(csvPath.c_str(), "w");
+        if (!csv)
+        {
+            fprintf(stderr, "cannot write %s\n", csvPath.c_str());
+            return 1;
+        }
+        fprintf(csv, "workload,allocator,threads,mops\n");
+    }
+
+    std::vector<size_t> counts = threadCounts(maxThreads);
+    printf("%zu ops per thread, median of %d runs, aggregate Mops/s (higher is better)\n", opsPerThread, repetitions);
+
+    for (const Workload& w : WORKLOADS)
+    {
+        if (!filter.empty() && filter != w.name) continue;
+
+        // 每个分配器在子进程中依次跑完所有线程数，先丢弃一轮预热
+        std::vector<std::vector<double>> results;
+        for (const Allocator* backend : ALLOCATORS)
+        {
+            const Allocator& a = *backend;
+            std::vector<double> mops;
+            bool ok = bench::runInChild([&]() {
+                if (a.init) a.init();
+                w.run(a, counts[0], opsPerThread);
+                std::vector<double> curve;
+                for (size_t n : counts)
+                {
+                    std::vector<double> runs;
+                    for (int r = 0; r < repetitions; ++r)
+                    {
+                        uint64_t ns = w.run(a, n, opsPerThread);
+                        runs.push_back(static_cast<double>(n * opsPerThread) * 1000.0 / ns);
+                    }
+                    curve.push_back(bench::median(runs));
+                }
+                return curve;
+            }, mops);
+            if (!ok) mops.clear(); // 分配器在该负载下崩溃，记为失败
+            results.push_back(mops);
+        }
+
+        printf("\n%s (%s)\n%8s", w.name, w.description, "threads");
+        for (const Allocator* a : ALLOCATORS) printf("%12s", a->name);
+        printf("\n");
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            printf("%8zu", counts[i]);
+            for (size_t j = 0; j < results.size(); ++j)
+            {
+                if (results[j].size() == counts.size())
+                {
+                    printf("%12.2f", results[j][i]);
+                    if (csv) fprintf(csv, "%s,%s,%zu,%.4f\n", w.name, ALLOCATORS[j]->name, counts[i], results[j][i]);
+                }
+                else
+                {
+                    printf("%12s", "failed");
+                }
+            }
+            printf("\n");
+        }
+        fflush(stdout);
+    }
+
+    if (csv) fclose(csv);
+    return 0;
+}
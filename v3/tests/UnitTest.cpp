@@ -1,4 +1,11 @@
 #include "../include/MemoryPool.h"
+#include "../include/ObjectPool.h"
+#include "../include/Arena.h"
+#include "../include/HeapProfiler.h"
+#include "../include/LatencyHistogram.h"
+#include "../include/TraceRecorder.h"
+#include "../include/ShardedHeap.h"
+#include "../include/Numa.h"
 #include <iostream>
 #include <vector>
 #include <thread>
@@ -7,6 +14,8 @@
 #include <random>
 #include <algorithm>
 #include <atomic>
+#include <string>
+#include <unistd.h>
 
 using namespace Kama_memoryPool;
 
@@ -153,6 +162,837 @@ void testEdgeCases()
     std::cout << "Edge cases test passed!" << std::endl;
 }
 
+// 对齐分配测试
+struct alignas(64) CacheLineObject : PoolAllocated
+{
+    char data[100];
+};
+
+void testAlignedAllocation() 
+{
+    std::cout << "Running aligned allocation test..." << std::endl;
+
+    const size_t sizes[] = {1, 24, 100, 3000, 40000, MAX_BYTES, MAX_BYTES + 1};
+    // 超过页大小的对齐（如2MB大页）从页缓存按对齐取span
+    for (size_t alignment = 8; alignment <= 2 * 1024 * 1024; alignment <<= 1) 
+    {
+        for (size_t size : sizes) 
+        {
+            void* ptr = MemoryPool::allocateAligned(size, alignment);
+            assert(ptr != nullptr);
+            assert((reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0);
+            memset(ptr, 0xAB, size);
+            MemoryPool::deallocateAligned(ptr, size, alignment);
+        }
+    }
+
+    // 非法对齐数
+    assert(MemoryPool::allocateAligned(64, 0) == nullptr);
+    assert(MemoryPool::allocateAligned(64, 48) == nullptr);
+
+    // 大对齐的块同样可按无大小版本释放
+    void* page = MemoryPool::allocateAligned(100, 64 * 1024);
+    assert(page != nullptr && (reinterpret_cast<uintptr_t>(page) & (64 * 1024 - 1)) == 0);
+    assert(MemoryPool::getAllocSize(page) >= 100);
+    MemoryPool::deallocate(page);
+
+    // C++17 对齐 operator new
+    std::vector<CacheLineObject*> objects;
+    for (int i = 0; i < 100; ++i) 
+    {
+        CacheLineObject* obj = new CacheLineObject;
+        assert((reinterpret_cast<uintptr_t>(obj) & 63) == 0);
+        objects.push_back(obj);
+    }
+    for (CacheLineObject* obj : objects) 
+    {
+        delete obj;
+    }
+
+    CacheLineObject* array = new CacheLineObject[7];
+    assert((reinterpret_cast<uintptr_t>(array) & 63) == 0);
+    delete[] array;
+
+    std::cout << "Aligned allocation test passed!" << std::endl;
+}
+
+// 按指针反查大小及无大小释放测试
+void testSizelessDeallocation() 
+{
+    std::cout << "Running sizeless deallocation test..." << std::endl;
+
+    const size_t sizes[] = {1, 8, 13, 100, 4096, 40000, MAX_BYTES, MAX_BYTES + 1, 3 * 1024 * 1024};
+    for (size_t size : sizes) 
+    {
+        void* ptr = MemoryPool::allocate(size);
+        assert(ptr != nullptr);
+        size_t usable = MemoryPool::getAllocSize(ptr);
+        assert(usable >= size);
+        memset(ptr, 0xCD, usable);
+        MemoryPool::deallocate(ptr);
+    }
+
+    // 非内存池分配的地址返回0
+    int onStack = 0;
+    assert(MemoryPool::getAllocSize(&onStack) == 0);
+    assert(MemoryPool::getAllocSize(nullptr) == 0);
+    (void)onStack;
+
+    std::cout << "Sizeless deallocation test passed!" << std::endl;
+}
+
+// 重新分配测试
+void testReallocate() 
+{
+    std::cout << "Running reallocate test..." << std::endl;
+
+    // 同一大小类内原地返回
+    void* ptr = MemoryPool::allocate(50);
+    void* same = MemoryPool::reallocate(ptr, 50, 56);
+    assert(same == ptr);
+    (void)same;
+
+    // 跨大小类时保留原有数据
+    memset(ptr, 0x5A, 56);
+    char* grown = static_cast<char*>(MemoryPool::reallocate(ptr, 56, 1000));
+    assert(grown != nullptr);
+    for (size_t i = 0; i < 56; ++i) 
+    {
+        assert(grown[i] == 0x5A);
+    }
+    MemoryPool::deallocate(grown, 1000);
+
+    // 大对象反复扩展，模拟vector增长
+    size_t size = MAX_BYTES + 1;
+    char* big = static_cast<char*>(MemoryPool::allocate(size));
+    memset(big, 0x11, size);
+    while (size < 16 * 1024 * 1024) 
+    {
+        size_t newSize = size * 2;
+        big = static_cast<char*>(MemoryPool::reallocate(big, size, newSize));
+        assert(big != nullptr);
+        assert(big[0] == 0x11 && big[size - 1] == 0x11);
+        memset(big + size, 0x11, newSize - size);
+        size = newSize;
+    }
+
+    // 大对象收缩原地完成
+    void* shrunk = MemoryPool::reallocate(big, size, MAX_BYTES + 1);
+    assert(shrunk == big);
+    (void)shrunk;
+    assert(MemoryPool::getAllocSize(big) == PageCache::numPagesOf(MAX_BYTES + 1) * PageCache::PAGE_SIZE);
+    MemoryPool::deallocate(big, MAX_BYTES + 1);
+
+    // 无大小版本
+    char* p = static_cast<char*>(MemoryPool::reallocate(nullptr, 10));
+    memcpy(p, "kama", 5);
+    p = static_cast<char*>(MemoryPool::reallocate(p, 4000));
+    p = static_cast<char*>(MemoryPool::reallocate(p, 2 * 1024 * 1024));
+    assert(strcmp(p, "kama") == 0);
+    MemoryPool::deallocate(p);
+
+    std::cout << "Reallocate test passed!" << std::endl;
+}
+
+// 批量分配测试
+void testBatchAllocation() 
+{
+    std::cout << "Running batch allocation test..." << std::endl;
+
+    for (size_t size : {size_t(24), size_t(200), size_t(5000), MAX_BYTES + 1}) 
+    {
+        const size_t N = 500;
+        std::vector<void*> ptrs(N);
+        size_t got = MemoryPool::allocateBatch(size, ptrs.data(), N);
+        assert(got == N);
+        (void)got;
+
+        // 每个块互不重叠且可写
+        for (size_t i = 0; i < N; ++i) 
+        {
+            memset(ptrs[i], static_cast<int>(i & 0xFF), size);
+        }
+        for (size_t i = 0; i < N; ++i) 
+        {
+            assert(static_cast<unsigned char*>(ptrs[i])[size - 1] == (i & 0xFF));
+        }
+
+        MemoryPool::deallocateBatch(size, ptrs.data(), N);
+    }
+
+    // 批量释放后再次批量分配应能复用
+    void* ptrs[64];
+    size_t got = MemoryPool::allocateBatch(64, ptrs, 64);
+    assert(got == 64);
+    MemoryPool::deallocateBatch(64, ptrs, 64);
+    got = MemoryPool::allocateBatch(64, ptrs, 64);
+    assert(got == 64);
+    (void)got;
+    for (void* ptr : ptrs) 
+    {
+        MemoryPool::deallocate(ptr, 64);
+    }
+
+    std::cout << "Batch allocation test passed!" << std::endl;
+}
+
+// 定类型对象池测试
+struct PoolNode
+{
+    int         id;
+    std::string name;
+    PoolNode*   next;
+
+    PoolNode(int i, std::string n) : id(i), name(std::move(n)), next(nullptr) {}
+};
+
+struct alignas(32) AlignedNode
+{
+    double values[3];
+};
+
+struct HugeNode
+{
+    char data[MAX_BYTES + 100];
+};
+
+void testObjectPool() 
+{
+    std::cout << "Running object pool test..." << std::endl;
+
+    static_assert(ObjectPool<AlignedNode>::BLOCK_SIZE % 32 == 0, "aligned block size");
+    static_assert(!ObjectPool<HugeNode>::USE_FREE_LIST, "huge object bypasses free list");
+
+    std::vector<PoolNode*> nodes;
+    for (int i = 0; i < 1000; ++i) 
+    {
+        nodes.push_back(make<PoolNode>(i, "node" + std::to_string(i)));
+    }
+    for (int i = 0; i < 1000; ++i) 
+    {
+        assert(nodes[i]->id == i);
+        assert(nodes[i]->name == "node" + std::to_string(i));
+        destroy(nodes[i]);
+    }
+
+    for (int i = 0; i < 100; ++i) 
+    {
+        AlignedNode* node = ObjectPool<AlignedNode>::make();
+        assert((reinterpret_cast<uintptr_t>(node) & 31) == 0);
+        ObjectPool<AlignedNode>::destroy(node);
+    }
+
+    {
+        pool_unique_ptr<PoolNode> node = make_pool_unique<PoolNode>(7, "unique");
+        assert(node->id == 7);
+        pool_unique_ptr<HugeNode> huge = make_pool_unique<HugeNode>();
+        huge->data[MAX_BYTES] = 1;
+    }
+
+    std::cout << "Object pool test passed!" << std::endl;
+}
+
+// 区域分配器测试
+void testArena() 
+{
+    std::cout << "Running arena test..." << std::endl;
+
+    Arena arena(1, 2);
+    assert(arena.bytesReserved() == 0);
+
+    // 小对象连续分配，跨越多个span
+    std::vector<int*> values;
+    for (int i = 0; i < 5000; ++i) 
+    {
+        int* value = arena.create<int>(i);
+        assert(value != nullptr);
+        values.push_back(value);
+    }
+    for (int i = 0; i < 5000; ++i) 
+    {
+        assert(*values[i] == i);
+    }
+
+    void* aligned = arena.allocate(100, 256);
+    assert((reinterpret_cast<uintptr_t>(aligned) & 255) == 0);
+    (void)aligned;
+
+    // 嵌套检查点
+    Arena::Checkpoint outer = arena.checkpoint();
+    char* first = static_cast<char*>(arena.allocate(64));
+    Arena::Checkpoint inner = arena.checkpoint();
+    void* big = arena.allocate(MAX_BYTES * 2);
+    assert(big != nullptr);
+    memset(big, 0xAB, MAX_BYTES * 2);
+    arena.rewind(inner);
+    void* next = arena.allocate(1, 1);
+    assert(next == first + 64);
+    arena.rewind(outer);
+    void* again = arena.allocate(64);
+    assert(again == first);
+    (void)first;
+    (void)next;
+    (void)again;
+
+    // 重置后保留的span被复用，不再向PageCache申请
+    arena.reset();
+    size_t reserved = arena.bytesReserved();
+    assert(reserved >= MAX_BYTES * 2);
+    arena.allocate(MAX_BYTES);
+    arena.allocate(16);
+    assert(arena.bytesReserved() == reserved);
+    (void)reserved;
+
+    std::cout << "Arena test passed!" << std::endl;
+}
+
+// 新span按需切分测试
+void testLazySpanCarving() 
+{
+    std::cout << "Running lazy span carving test..." << std::endl;
+
+    // 该大小类此前未被使用，每次只从中心缓存取1块，块按地址顺序从新span中切出
+    const size_t SIZE = 2040;
+    const size_t SPAN_BLOCKS = 8 * PageCache::PAGE_SIZE / SIZE;
+    auto centralBlocks = []() {
+        for (const auto& cls : MemoryPool::getStats().sizeClasses)
+        {
+            if (cls.size == SIZE) return cls.centralCachedBlocks;
+        }
+        return size_t(0);
+    };
+
+    char* first = static_cast<char*>(MemoryPool::allocate(SIZE));
+    char* second = static_cast<char*>(MemoryPool::allocate(SIZE));
+    assert(second - first == static_cast<ptrdiff_t>(SIZE));
+    // 未切出的块仍计为中心缓存的空闲块
+    assert(centralBlocks() == SPAN_BLOCKS - 2);
+
+    // 取完整个span后切换到新span
+    std::vector<char*> ptrs = {first, second};
+    for (size_t i = 2; i < SPAN_BLOCKS + 1; ++i)
+    {
+        ptrs.push_back(static_cast<char*>(MemoryPool::allocate(SIZE)));
+        memset(ptrs.back(), 0xAB, SIZE);
+    }
+    assert(ptrs[SPAN_BLOCKS - 1] - first == static_cast<ptrdiff_t>((SPAN_BLOCKS - 1) * SIZE));
+    assert(centralBlocks() == SPAN_BLOCKS - 1);
+    (void)centralBlocks;
+    for (char* ptr : ptrs)
+    {
+        MemoryPool::deallocate(ptr, SIZE);
+    }
+
+    std::cout << "Lazy span carving test passed!" << std::endl;
+}
+
+// 页缓存空闲span分箱测试
+void testSpanBins() 
+{
+    std::cout << "Running span bins test..." << std::endl;
+
+    // 页数跨过精确分箱的上限，覆盖分箱与大span树两条路径
+    PageCache& pages = PageCache::getInstance();
+    // 空闲字节减去向系统提交的字节
+    auto freeBytes = [&pages]() {
+        PoolStats stats;
+        pages.collectStats(stats);
+        return static_cast<ptrdiff_t>(stats.pageCacheFreeBytes) - static_cast<ptrdiff_t>(stats.mappedBytes);
+    };
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<size_t> dist(1, 2 * PageCache::NUM_BINS);
+    std::vector<std::pair<char*, size_t>> spans;
+    for (int round = 0; round < 4; ++round)
+    {
+        // 无论取自空闲span还是新提交的页，空闲字节都比新提交的字节恰好少所需页数
+        while (spans.size() < 64)
+        {
+            size_t numPages = dist(gen);
+            ptrdiff_t before = freeBytes();
+            char* ptr = static_cast<char*>(pages.allocateSpan(numPages));
+            assert(ptr != nullptr);
+            assert(freeBytes() == before - static_cast<ptrdiff_t>(numPages * PageCache::PAGE_SIZE));
+            (void)before;
+            memset(ptr, static_cast<int>(spans.size()), numPages * PageCache::PAGE_SIZE);
+            spans.push_back({ptr, numPages});
+        }
+        // span之间不重叠
+        for (size_t i = 0; i < spans.size(); ++i)
+        {
+            assert(spans[i].first[0] == static_cast<char>(i));
+            assert(spans[i].first[spans[i].second * PageCache::PAGE_SIZE - 1] == static_cast<char>(i));
+        }
+
+        // 乱序释放一半，合并不改变空闲字节总数
+        std::shuffle(spans.begin(), spans.end(), gen);
+        for (size_t i = 0; i < 32; ++i)
+        {
+            ptrdiff_t before = freeBytes();
+            pages.deallocateSpan(spans.back().first, spans.back().second);
+            assert(freeBytes() == before + static_cast<ptrdiff_t>(spans.back().second * PageCache::PAGE_SIZE));
+            (void)before;
+            spans.pop_back();
+        }
+        for (size_t i = 0; i < spans.size(); ++i)
+        {
+            memset(spans[i].first, static_cast<int>(i), spans[i].second * PageCache::PAGE_SIZE);
+        }
+    }
+    for (const auto& span : spans)
+    {
+        pages.deallocateSpan(span.first, span.second);
+    }
+
+    std::cout << "Span bins test passed!" << std::endl;
+}
+
+// 预留地址区域测试
+void testAddressRegion() 
+{
+    std::cout << "Running address region test..." << std::endl;
+
+    PageCache& pages = PageCache::getInstance();
+    const size_t PAGE = PageCache::PAGE_SIZE;
+    auto freeBytes = [&pages]() {
+        PoolStats stats;
+        pages.collectStats(stats);
+        return stats.pageCacheFreeBytes;
+    };
+
+    // 超大块扩展：内容保留，数据页由mremap搬移
+    const size_t OLD_PAGES = PageCache::REMAP_THRESHOLD_PAGES;
+    char* big = static_cast<char*>(pages.allocateSpan(OLD_PAGES, OLD_PAGES * PAGE));
+    for (size_t i = 0; i < OLD_PAGES; ++i) big[i * PAGE] = static_cast<char>(i);
+    void* guard = pages.allocateSpan(1);
+    char* moved = static_cast<char*>(pages.reallocateSpan(big, OLD_PAGES, 4 * OLD_PAGES));
+    assert(moved != nullptr);
+    assert(PageCache::objectSize(moved) == 4 * OLD_PAGES * PAGE);
+    for (size_t i = 0; i < OLD_PAGES; ++i) assert(moved[i * PAGE] == static_cast<char>(i));
+    memset(moved + OLD_PAGES * PAGE, 1, 3 * OLD_PAGES * PAGE);
+
+    // 页缓存中的空闲页都可写：搬走后的旧地址范围须已重新映射
+    std::vector<void*> all;
+    while (freeBytes() > 0)
+    {
+        char* page = static_cast<char*>(pages.allocateSpan(1));
+        page[0] = 1;
+        page[PAGE - 1] = 1;
+        all.push_back(page);
+    }
+
+    // 归还紧邻顶部的span时，顶部下方的空闲span一并并回顶部，不留在空闲列表中
+    char* below = static_cast<char*>(pages.allocateSpan(1));
+    char* top = static_cast<char*>(pages.allocateSpan(1));
+    assert(top == below + PAGE);
+    pages.deallocateSpan(below, 1);
+    pages.deallocateSpan(top, 1);
+    PoolStats stats;
+    pages.collectStats(stats);
+    assert(stats.pageCacheFreeSpans == 1);
+    char* merged = static_cast<char*>(pages.allocateSpan(2));
+    assert(merged == below);
+    (void)top;
+    pages.deallocateSpan(merged, 2);
+
+    for (void* page : all) pages.deallocateSpan(page, 1);
+    pages.deallocateSpan(moved, 4 * OLD_PAGES);
+    pages.deallocateSpan(guard, 1);
+
+    std::cout << "Address region test passed!" << std::endl;
+}
+
+// NUMA分区测试；单节点机器上可用KAMA_NUMA_NODES=2模拟多分区（make numa_test）
+void testNuma() 
+{
+    std::cout << "Running NUMA partition test..." << std::endl;
+
+    const size_t nodes = Numa::nodeCount();
+    assert(nodes >= 1 && nodes <= Numa::MAX_NODES);
+    assert(Numa::currentNode() < nodes);
+    if (nodes == 1)
+    {
+        void* ptr = MemoryPool::allocate(64);
+        assert(PageCache::nodeOf(ptr) == 0);
+        MemoryPool::deallocate(ptr, 64);
+        std::cout << "NUMA partition test passed (single partition)!" << std::endl;
+        return;
+    }
+
+    // 固定在最后一个节点的线程分配的块都来自该节点的分区
+    const size_t SIZE = 1576;
+    const size_t COUNT = 1000;
+    const size_t REMOTE = nodes - 1;
+    std::vector<void*> ptrs(COUNT);
+    void* large = nullptr;
+    std::thread([&]() {
+        Numa::pinThread(REMOTE);
+        for (auto& ptr : ptrs)
+        {
+            ptr = MemoryPool::allocate(SIZE);
+            assert(PageCache::nodeOf(ptr) == REMOTE);
+        }
+        large = MemoryPool::allocate(MAX_BYTES + 1);
+        assert(PageCache::nodeOf(large) == REMOTE);
+    }).join();
+
+    // 节点0上的线程释放，块和span都回到所属分区
+    std::thread([&]() {
+        Numa::pinThread(0);
+        for (void* ptr : ptrs) MemoryPool::deallocate(ptr, SIZE);
+        MemoryPool::deallocate(large, MAX_BYTES + 1);
+    }).join();
+
+    // 节点0的新线程取到的都是本节点的块；所属节点的线程重新取到原来的大块
+    std::thread([&]() {
+        Numa::pinThread(0);
+        for (auto& ptr : ptrs)
+        {
+            ptr = MemoryPool::allocate(SIZE);
+            assert(PageCache::nodeOf(ptr) == 0);
+        }
+        for (void* ptr : ptrs) MemoryPool::deallocate(ptr, SIZE);
+    }).join();
+    std::thread([&]() {
+        Numa::pinThread(REMOTE);
+        void* again = MemoryPool::allocate(MAX_BYTES + 1);
+        assert(again == large);
+        MemoryPool::deallocate(again, MAX_BYTES + 1);
+    }).join();
+
+    // 各分区的锁互相独立，不同节点的线程并发分配释放大块时共用的元数据分配器不能出错
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < 2 * nodes; ++t)
+    {
+        workers.emplace_back([t]() {
+            Numa::pinThread(t);
+            std::vector<std::pair<void*, size_t>> live;
+            for (size_t i = 0; i < 50000; ++i)
+            {
+                size_t size = MAX_BYTES + 1 + (i * 7919 % 64) * (1 + i % 3) * PageCache::PAGE_SIZE;
+                void* ptr = MemoryPool::allocate(size);
+                assert(PageCache::nodeOf(ptr) == t % Numa::nodeCount());
+                live.push_back({ptr, size});
+                if (live.size() > 32)
+                {
+                    std::swap(live[i % live.size()], live.back());
+                    MemoryPool::deallocate(live.back().first, live.back().second);
+                    live.pop_back();
+                }
+            }
+            for (auto& alloc : live) MemoryPool::deallocate(alloc.first, alloc.second);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    std::cout << "NUMA partition test passed!" << std::endl;
+}
+
+// 分片小对象堆测试
+void testShardedHeap() 
+{
+    std::cout << "Running sharded heap test..." << std::endl;
+
+    // 本线程首次使用，连续分配从同一页中顺序切出
+    const size_t SIZE = 48;
+    const size_t NUM = 1000;
+    std::vector<char*> ptrs;
+    for (size_t i = 0; i < NUM; ++i) 
+    {
+        char* ptr = static_cast<char*>(ShardedHeap::allocate(SIZE));
+        assert(ptr != nullptr);
+        memset(ptr, static_cast<int>(i & 0xFF), SIZE);
+        ptrs.push_back(ptr);
+    }
+    for (size_t i = 1; i < 64; ++i) 
+    {
+        assert(ptrs[i] - ptrs[i - 1] == static_cast<ptrdiff_t>(SIZE));
+    }
+    for (size_t i = 0; i < NUM; ++i) 
+    {
+        assert(ptrs[i][SIZE - 1] == static_cast<char>(i & 0xFF));
+    }
+
+    // 其他线程释放的块由所有者收回复用，不再申请新页
+    std::thread remote([&]() {
+        for (char* ptr : ptrs) ShardedHeap::deallocate(ptr, SIZE);
+    });
+    remote.join();
+    size_t pages = ShardedHeap::pageCount();
+    for (size_t i = 0; i < NUM; ++i) 
+    {
+        ptrs[i] = static_cast<char*>(ShardedHeap::allocate(SIZE));
+    }
+    assert(ShardedHeap::pageCount() == pages);
+    (void)pages;
+    for (char* ptr : ptrs) ShardedHeap::deallocate(ptr, SIZE);
+
+    // 线程退出后仍有存活块的页被遗弃，由之后需要该大小类的线程接管
+    const size_t ADOPT_SIZE = 64;
+    std::vector<void*> survivors;
+    std::thread worker([&]() {
+        for (size_t i = 0; i < 100; ++i) 
+        {
+            void* ptr = ShardedHeap::allocate(ADOPT_SIZE);
+            if (i % 2) survivors.push_back(ptr);
+            else ShardedHeap::deallocate(ptr, ADOPT_SIZE);
+        }
+    });
+    worker.join();
+    pages = ShardedHeap::pageCount();
+    for (void* ptr : survivors) ShardedHeap::deallocate(ptr, ADOPT_SIZE);
+    void* adopted = ShardedHeap::allocate(ADOPT_SIZE);
+    assert(ShardedHeap::pageCount() == pages);
+    ShardedHeap::deallocate(adopted, ADOPT_SIZE);
+
+    // 超过MAX_SMALL的对象转交MemoryPool
+    void* large = ShardedHeap::allocate(ShardedHeap::MAX_SMALL + 1);
+    assert(MemoryPool::getAllocSize(large) >= ShardedHeap::MAX_SMALL + 1);
+    ShardedHeap::deallocate(large, ShardedHeap::MAX_SMALL + 1);
+
+    // 多线程交叉分配释放，对象内容不被破坏
+    const size_t THREADS = 4;
+    std::vector<std::vector<std::pair<char*, size_t>>> handoff(THREADS);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; ++t) 
+    {
+        threads.emplace_back([&, t]() {
+            std::mt19937 gen(static_cast<unsigned>(t));
+            std::uniform_int_distribution<size_t> sizeDist(1, 1024);
+            for (size_t i = 0; i < 20000; ++i) 
+            {
+                size_t size = sizeDist(gen);
+                char* ptr = static_cast<char*>(ShardedHeap::allocate(size));
+                memset(ptr, static_cast<int>(t + 1), size);
+                handoff[t].emplace_back(ptr, size);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    threads.clear();
+    // 每个线程释放下一个线程分配的对象
+    for (size_t t = 0; t < THREADS; ++t) 
+    {
+        threads.emplace_back([&, t]() {
+            size_t owner = (t + 1) % THREADS;
+            for (auto [ptr, size] : handoff[owner]) 
+            {
+                assert(ptr[0] == static_cast<char>(owner + 1) && ptr[size - 1] == static_cast<char>(owner + 1));
+                ShardedHeap::deallocate(ptr, size);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    std::cout << "Sharded heap test passed!" << std::endl;
+}
+
+// 统计信息测试
+void testStats() 
+{
+    std::cout << "Running stats test..." << std::endl;
+
+    const size_t SIZE = 200;
+    const size_t NUM = 1000;
+    auto findClass = [](const PoolStats& stats, size_t size) {
+        for (const auto& cls : stats.sizeClasses)
+        {
+            if (cls.size == size) return cls;
+        }
+        return SizeClassStats{};
+    };
+
+    PoolStats before = MemoryPool::getStats();
+    SizeClassStats clsBefore = findClass(before, SIZE);
+
+    std::vector<void*> ptrs;
+    for (size_t i = 0; i < NUM; ++i) 
+    {
+        ptrs.push_back(MemoryPool::allocate(SIZE));
+    }
+    for (void* ptr : ptrs) 
+    {
+        MemoryPool::deallocate(ptr, SIZE);
+    }
+    void* large = MemoryPool::allocate(MAX_BYTES * 2);
+    MemoryPool::deallocate(large, MAX_BYTES * 2);
+
+    // 其他线程的计数在线程退出后仍然保留
+    std::thread worker([&]() {
+        for (size_t i = 0; i < NUM; ++i) 
+        {
+            MemoryPool::deallocate(MemoryPool::allocate(SIZE), SIZE);
+        }
+    });
+    worker.join();
+
+    PoolStats after = MemoryPool::getStats();
+    SizeClassStats clsAfter = findClass(after, SIZE);
+    assert(clsAfter.allocs - clsBefore.allocs == NUM * 2);
+    assert(clsAfter.frees - clsBefore.frees == NUM * 2);
+    assert(clsAfter.refills > clsBefore.refills);
+    assert(clsAfter.hitRate() > 0.5);
+    assert(after.largeAllocs - before.largeAllocs == 1);
+    assert(after.largeFrees - before.largeFrees == 1);
+    assert(after.threadCacheBytes > 0);
+    assert(after.mappedBytes >= after.pageCacheFreeBytes);
+    (void)clsBefore;
+    (void)clsAfter;
+
+    FILE* out = tmpfile();
+    assert(out != nullptr);
+    MemoryPool::dumpStats(out);
+    assert(ftell(out) > 0);
+    fclose(out);
+
+    std::cout << "Stats test passed!" << std::endl;
+}
+
+// 堆采样测试
+void testHeapProfiler() 
+{
+    std::cout << "Running heap profiler test..." << std::endl;
+
+    HeapProfiler::start(4096);
+
+    std::vector<std::pair<void*, size_t>> allocations;
+    for (size_t i = 0; i < 2000; ++i) 
+    {
+        size_t size = (i % 10 == 0) ? MAX_BYTES + i : 64 + i % 100;
+        void* ptr = MemoryPool::allocate(size);
+        assert(ptr != nullptr);
+        memset(ptr, static_cast<int>(i), std::min(size, size_t(64)));
+        allocations.push_back({ptr, size});
+    }
+    size_t sampled = HeapProfiler::liveSamples();
+    assert(sampled > 0);
+    (void)sampled;
+
+    // 采样对象页对齐，仍可按地址反查大小并正常realloc
+    for (auto& alloc : allocations) 
+    {
+        if (alloc.second <= MAX_BYTES && HeapProfiler::isSampled(alloc.first)) 
+        {
+            assert((reinterpret_cast<uintptr_t>(alloc.first) & (PageCache::PAGE_SIZE - 1)) == 0);
+            assert(MemoryPool::getAllocSize(alloc.first) >= alloc.second);
+            unsigned char first = *static_cast<unsigned char*>(alloc.first);
+            alloc.first = MemoryPool::reallocate(alloc.first, alloc.second, alloc.second * 2);
+            alloc.second *= 2;
+            assert(*static_cast<unsigned char*>(alloc.first) == first);
+            (void)first;
+            break;
+        }
+    }
+
+    FILE* out = tmpfile();
+    assert(out != nullptr);
+    HeapProfiler::writeHeapProfile(out);
+    rewind(out);
+    char header[64] = {};
+    char* line = fgets(header, sizeof(header), out);
+    assert(line != nullptr);
+    assert(strncmp(header, "heap profile:", 13) == 0);
+    (void)line;
+    fclose(out);
+
+    out = tmpfile();
+    HeapProfiler::writeCollapsedStacks(out);
+    assert(ftell(out) > 0);
+    fclose(out);
+
+    HeapProfiler::stop();
+    for (size_t i = 0; i < allocations.size(); ++i) 
+    {
+        if (i % 2) MemoryPool::deallocate(allocations[i].first, allocations[i].second);
+        else MemoryPool::deallocate(allocations[i].first);
+    }
+    assert(HeapProfiler::liveSamples() == 0);
+
+    std::cout << "Heap profiler test passed!" << std::endl;
+}
+
+// 延迟直方图测试
+void testLatencyHistogram() 
+{
+    std::cout << "Running latency histogram test..." << std::endl;
+
+    // 分桶上界不小于值本身，且相对误差不超过1/8
+    for (uint64_t value : {uint64_t(0), uint64_t(7), uint64_t(8), uint64_t(100), uint64_t(12345), 
+                           uint64_t(1) << 40, ~uint64_t(0)}) 
+    {
+        uint64_t upper = LatencyHistogram::bucketUpperBound(LatencyHistogram::bucketOf(value));
+        assert(upper >= value);
+        assert(upper - value <= value / 8);
+        (void)upper;
+    }
+
+    LatencyHistogram::reset();
+    for (uint64_t i = 1; i <= 1000; ++i) 
+    {
+        LatencyHistogram::record(LatencyOp::PAGE_SYSTEM_ALLOC, i * 1000);
+    }
+    LatencySnapshot s = LatencyHistogram::snapshot(LatencyOp::PAGE_SYSTEM_ALLOC);
+    assert(s.count == 1000);
+    assert(s.p50 <= s.p99 && s.p99 <= s.p999 && s.p999 <= s.max * 1.125);
+    assert(s.p99 >= s.p50 * 1.5);
+    (void)s;
+    LatencyHistogram::reset();
+    assert(LatencyHistogram::snapshot(LatencyOp::PAGE_SYSTEM_ALLOC).count == 0);
+
+    std::cout << "Latency histogram test passed!" << std::endl;
+}
+
+// 轨迹记录测试
+void testTraceRecorder() 
+{
+    std::cout << "Running trace recorder test..." << std::endl;
+
+    char path[] = "/tmp/kama_trace_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    bool started = TraceRecorder::start(path);
+    assert(started);
+    // 已在记录时再次启动失败
+    bool restarted = TraceRecorder::start(path);
+    assert(!restarted);
+    (void)started;
+    (void)restarted;
+    void* small = MemoryPool::allocate(40);
+    void* large = MemoryPool::allocate(MAX_BYTES + 1);
+    std::thread worker([small]() { MemoryPool::deallocate(small, 40); });
+    worker.join();
+    MemoryPool::deallocate(large, MAX_BYTES + 1);
+    TraceRecorder::stop();
+    // 停止后不再记录
+    MemoryPool::deallocate(MemoryPool::allocate(40), 40);
+
+    FILE* in = fopen(path, "rb");
+    assert(in != nullptr);
+    TraceHeader header;
+    size_t headers = fread(&header, sizeof(header), 1, in);
+    assert(headers == 1);
+    assert(memcmp(header.magic, "KAMATRC1", 8) == 0 && header.recordSize == sizeof(TraceRecord));
+    (void)headers;
+    std::vector<TraceRecord> records(8);
+    records.resize(fread(records.data(), sizeof(TraceRecord), records.size(), in));
+    fclose(in);
+    unlink(path);
+
+    assert(records.size() == 4);
+    std::sort(records.begin(), records.end(), 
+              [](const TraceRecord& a, const TraceRecord& b) { return a.timestamp < b.timestamp; });
+    assert(records[0].op == static_cast<uint8_t>(TraceOp::ALLOC) && records[0].size == 40);
+    assert(records[0].ptr == reinterpret_cast<uintptr_t>(small));
+    assert(records[1].op == static_cast<uint8_t>(TraceOp::ALLOC) && records[1].size == MAX_BYTES + 1);
+    assert(records[2].op == static_cast<uint8_t>(TraceOp::FREE) && records[2].ptr == records[0].ptr);
+    assert(records[2].thread != records[0].thread);
+    assert(records[3].op == static_cast<uint8_t>(TraceOp::FREE) && records[3].ptr == records[1].ptr);
+
+    std::cout << "Trace recorder test passed!" << std::endl;
+}
+
 // 压力测试
 void testStress() 
 {
@@ -189,9 +1029,24 @@ int main()
         std::cout << "Starting memory pool tests..." << std::endl;
 
         testBasicAllocation();
+        testLazySpanCarving();
+        testSpanBins();
+        testAddressRegion();
+        testNuma();
         testMemoryWriting();
         testMultiThreading();
         testEdgeCases();
+        testAlignedAllocation();
+        testSizelessDeallocation();
+        testReallocate();
+        testBatchAllocation();
+        testObjectPool();
+        testArena();
+        testShardedHeap();
+        testStats();
+        testHeapProfiler();
+        testLatencyHistogram();
+        testTraceRecorder();
         testStress();
 
         std::cout << "All tests passed successfully!" << std::endl;
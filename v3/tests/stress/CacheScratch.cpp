@@ -0,0 +1,44 @@
+// cache-scratch（Hoard）：被动伪共享。主线程连续分配若干小对象（很可能位于同一缓存行）分给各线程，
+// 线程先释放拿到的对象，再反复分配同样大小的对象并写入。若分配器把释放的块交还给该线程，
+// 各线程就会在同一缓存行上反复写入
+// 用法：cache-scratch [threads=CPU数] [iterations=1000] [size=8] [repetitions=1000]
+#include "../BenchUtil.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    auto arg = [&](int i, long def) { return argc > i ? atol(argv[i]) : def; };
+    size_t numThreads = std::max(arg(1, bench::cpuCount()), 1L);
+    size_t iterations = arg(2, 1000);
+    size_t size = std::max(arg(3, 8), 1L);
+    size_t repetitions = arg(4, 1000);
+
+    std::vector<char*> initial(numThreads);
+    for (auto& obj : initial)
+    {
+        obj = new char[size];
+    }
+
+    uint64_t elapsed = bench::runThreads(numThreads, [&](size_t t) {
+        delete[] initial[t];
+        for (size_t it = 0; it < iterations; ++it)
+        {
+            char* obj = new char[size];
+            for (size_t r = 0; r < repetitions; ++r)
+            {
+                for (size_t k = 0; k < size; ++k)
+                {
+                    obj[k] = static_cast<char>(obj[k] + 1);
+                    bench::doNotOptimize(obj[k]);
+                }
+            }
+            delete[] obj;
+        }
+    });
+
+    printf("%s: %zu threads, %zu iterations, %zu bytes, %zu repetitions: %.3f s\n", bench::programName(argv[0]),
+           numThreads, iterations, size, repetitions, elapsed / 1e9);
+    return 0;
+}
@@ -0,0 +1,35 @@
+// cache-thrash（Hoard）：主动伪共享。各线程独立地反复分配小对象、写入、释放；
+// 若分配器把同一缓存行中的相邻块分给不同线程，各线程的写入会互相使缓存行失效
+// 用法：cache-thrash [threads=CPU数] [iterations=1000] [size=8] [repetitions=1000]
+#include "../BenchUtil.h"
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char* argv[])
+{
+    auto arg = [&](int i, long def) { return argc > i ? atol(argv[i]) : def; };
+    size_t numThreads = std::max(arg(1, bench::cpuCount()), 1L);
+    size_t iterations = arg(2, 1000);
+    size_t size = std::max(arg(3, 8), 1L);
+    size_t repetitions = arg(4, 1000);
+
+    uint64_t elapsed = bench::runThreads(numThreads, [&](size_t) {
+        for (size_t it = 0; it < iterations; ++it)
+        {
+            char* obj = new char[size];
+            for (size_t r = 0; r < repetitions; ++r)
+            {
+                for (size_t k = 0; k < size; ++k)
+                {
+                    obj[k] = static_cast<char>(obj[k] + 1);
+                    bench::doNotOptimize(obj[k]);
+                }
+            }
+            delete[] obj;
+        }
+    });
+
+    printf("%s: %zu threads, %zu iterations, %zu bytes, %zu repetitions: %.3f s\n", bench::programName(argv[0]),
+           numThreads, iterations, size, repetitions, elapsed / 1e9);
+    return 0;
+}
@@ -0,0 +1,107 @@
+// larson：服务器负载模拟（Larson & Krishnan）。每个线程持有一组对象，不断随机释放其中一个并分配新大小；
+// 完成 rounds*chunks 次替换后线程退出，由新线程接手同一组对象，因此大量对象由非分配线程释放。
+// 主线程预先分配初始对象。按墙钟时间统计每秒替换次数
+// 用法：larson [seconds=3] [min=8] [max=1000] [chunks=5000] [rounds=100] [seed=4141] [threads=CPU数]
+#include "../BenchUtil.h"
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Area
+{
+    std::vector<char*> blocks;
+    size_t   minSize;
+    size_t   maxSize;
+    size_t   rounds;
+    uint64_t seed;
+    uint64_t ops;
+    uint64_t threads; // 接手过这组对象的线程数
+};
+
+std::atomic<bool>   stopFlag{false};
+std::atomic<size_t> activeThreads{0};
+
+uint64_t nextRandom(uint64_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+void exerciseHeap(Area* area)
+{
+    size_t chunks = area->blocks.size();
+    size_t range = area->maxSize - area->minSize + 1;
+    for (size_t i = 0; i < area->rounds * chunks && !stopFlag.load(std::memory_order_relaxed); ++i)
+    {
+        size_t victim = nextRandom(area->seed) % chunks;
+        free(area->blocks[victim]);
+        size_t size = area->minSize + nextRandom(area->seed) % range;
+        char* block = static_cast<char*>(malloc(size));
+        block[0] = static_cast<char>(size);
+        bench::doNotOptimize(block);
+        area->blocks[victim] = block;
+        area->ops++;
+    }
+
+    // 线程退出，由新线程继续使用同一组对象
+    if (!stopFlag.load(std::memory_order_relaxed))
+    {
+        area->threads++;
+        activeThreads.fetch_add(1);
+        std::thread(exerciseHeap, area).detach();
+    }
+    activeThreads.fetch_sub(1);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    auto arg = [&](int i, long def) { return argc > i ? atol(argv[i]) : def; };
+    long seconds = arg(1, 3);
+    size_t minSize = arg(2, 8);
+    size_t maxSize = std::max<size_t>(arg(3, 1000), minSize);
+    size_t chunks = std::max(arg(4, 5000), 1L);
+    size_t rounds = std::max(arg(5, 100), 1L);
+    uint64_t seed = arg(6, 4141);
+    size_t numThreads = std::max(arg(7, bench::cpuCount()), 1L);
+
+    std::vector<Area> areas(numThreads);
+    for (size_t t = 0; t < numThreads; ++t)
+    {
+        Area& area = areas[t];
+        area = Area{std::vector<char*>(chunks), minSize, maxSize, rounds, seed + t * 7919 + 1, 0, 1};
+        for (auto& block : area.blocks)
+        {
+            block = static_cast<char*>(malloc(minSize + nextRandom(area.seed) % (maxSize - minSize + 1)));
+        }
+    }
+
+    uint64_t start = bench::nowNs();
+    activeThreads.store(numThreads);
+    for (Area& area : areas)
+    {
+        std::thread(exerciseHeap, &area).detach();
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stopFlag.store(true);
+    while (activeThreads.load() > 0) std::this_thread::yield();
+    double elapsed = (bench::nowNs() - start) / 1e9;
+
+    uint64_t ops = 0, threads = 0;
+    for (Area& area : areas)
+    {
+        ops += area.ops;
+        threads += area.threads;
+        for (char* block : area.blocks) free(block);
+    }
+    printf("%s: %zu threads, %zu-%zu bytes, %zu chunks, %zu rounds: %.0f ops/s (%lu threads created)\n",
+           bench::programName(argv[0]), numThreads, minSize, maxSize, chunks, rounds, ops / elapsed, static_cast<unsigned long>(threads));
+    return 0;
+}
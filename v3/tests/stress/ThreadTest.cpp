@@ -0,0 +1,42 @@
+// threadtest（Hoard）：每个线程反复分配一批对象再全部释放，线程间没有共享，考察纯粹的多线程扩展性
+// 用法：threadtest [threads=CPU数] [iterations=50] [objects=30000] [work=0] [size=8]
+#include "../BenchUtil.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    auto arg = [&](int i, long def) { return argc > i ? atol(argv[i]) : def; };
+    size_t numThreads = std::max(arg(1, bench::cpuCount()), 1L);
+    size_t iterations = arg(2, 50);
+    size_t objects = arg(3, 30000);
+    size_t work = arg(4, 0);
+    size_t size = std::max(arg(5, 8), 1L);
+
+    // 总对象数在线程间平分，与原版一致
+    size_t perThread = std::max<size_t>(objects / numThreads, 1);
+    uint64_t elapsed = bench::runThreads(numThreads, [&](size_t) {
+        std::vector<char*> ptrs(perThread);
+        for (size_t it = 0; it < iterations; ++it)
+        {
+            for (size_t i = 0; i < perThread; ++i)
+            {
+                ptrs[i] = new char[size];
+                // 模拟对对象的处理
+                for (volatile size_t w = 0; w < work; ++w)
+                {
+                }
+                bench::doNotOptimize(ptrs[i]);
+            }
+            for (size_t i = 0; i < perThread; ++i)
+            {
+                delete[] ptrs[i];
+            }
+        }
+    });
+
+    printf("%s: %zu threads, %zu iterations, %zu objects of %zu bytes: %.3f s\n", bench::programName(argv[0]),
+           numThreads, iterations, objects, size, elapsed / 1e9);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// xmalloc-test（Lever & Boreham）：一半线程只分配，另一半线程只释放，
+// 分配线程把整批指针挂到加锁的共享链表上，释放线程取下后逐个释放。统计每秒释放次数
+// 用法：xmalloc-test [-w workers=CPU数] [-t seconds=3] [-s size=64]
+#include "../BenchUtil.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+
+const size_t BATCH = 4096;
+const size_t MAX_PENDING = 256; // 释放跟不上时分配线程等待，避免内存无限增长
+
+struct Batch
+{
+    Batch* next;
+    size_t count;
+    void*  ptrs[BATCH];
+};
+
+std::mutex          listMutex;
+Batch*              pending = nullptr;
+size_t              pendingCount = 0;
+std::atomic<bool>   stopFlag{false};
+std::atomic<size_t> producersLeft{0};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t workers = bench::cpuCount();
+    long seconds = 3;
+    size_t size = 64;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-w") == 0) workers = std::max(atol(argv[i + 1]), 1L);
+        else if (strcmp(argv[i], "-t") == 0) seconds = std::max(atol(argv[i + 1]), 1L);
+        else if (strcmp(argv[i], "-s") == 0) size = std::max(atol(argv[i + 1]), 1L);
+    }
+
+    producersLeft.store(workers);
+    std::atomic<uint64_t> frees{0};
+    std::thread timer([&]() {
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stopFlag.store(true);
+    });
+
+    uint64_t elapsed = bench::runThreads(workers * 2, [&](size_t t) {
+        if (t < workers)
+        {
+            while (!stopFlag.load(std::memory_order_relaxed))
+            {
+                Batch* batch = static_cast<Batch*>(malloc(sizeof(Batch)));
+                batch->count = BATCH;
+                for (size_t i = 0; i < BATCH; ++i)
+                {
+                    batch->ptrs[i] = malloc(size);
+                    *static_cast<char*>(batch->ptrs[i]) = 0;
+                }
+                while (!stopFlag.load(std::memory_order_relaxed))
+                {
+                    std::lock_guard<std::mutex> lock(listMutex);
+                    if (pendingCount < MAX_PENDING) break;
+                }
+                std::lock_guard<std::mutex> lock(listMutex);
+                batch->next = pending;
+                pending = batch;
+                pendingCount++;
+            }
+            producersLeft.fetch_sub(1);
+        }
+        else
+        {
+            uint64_t count = 0;
+            for (;;)
+            {
+                // 先读生产者计数再取链表，读到0之后链表为空才说明全部取完
+                bool producersDone = producersLeft.load() == 0;
+                Batch* batch = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(listMutex);
+                    if (pending)
+                    {
+                        batch = pending;
+                        pending = batch->next;
+                        pendingCount--;
+                    }
+                }
+                if (!batch)
+                {
+                    if (producersDone) break;
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (size_t i = 0; i < batch->count; ++i)
+                {
+                    free(batch->ptrs[i]);
+                }
+                free(batch);
+                count += BATCH;
+            }
+            frees.fetch_add(count);
+        }
+    });
+    timer.join();
+
+    printf("%s: %zu alloc + %zu free threads, %zu bytes: %.0f frees/s\n", bench::programName(argv[0]), workers,
+           workers, size, frees.load() / (elapsed / 1e9));
+    return 0;
+}